@@ -34,3 +34,121 @@ TEST_CASE ("Boot performance")
         });
     };
 }
+
+TEST_CASE ("Prepare performance")
+{
+    juce::AudioBuffer<float> buffer (2, 512);
+    juce::MidiBuffer midi;
+
+    BENCHMARK_ADVANCED ("Time to first audio")
+    (Catch::Benchmark::Chronometer meter)
+    {
+        // destroyed after the measurement
+        std::vector<std::unique_ptr<PluginProcessor>> plugins (size_t (meter.runs()));
+        meter.measure ([&] (int i) {
+            auto& plugin = plugins[(size_t) i];
+            plugin = std::make_unique<PluginProcessor>();
+            plugin->prepareToPlay (48000.0, 512);
+            buffer.clear();
+            plugin->processBlock (buffer, midi);
+        });
+    };
+
+    BENCHMARK_ADVANCED ("Repeated prepare at the same rate")
+    (Catch::Benchmark::Chronometer meter)
+    {
+        PluginProcessor plugin;
+        plugin.prepareToPlay (48000.0, 512);
+        meter.measure ([&] {
+            plugin.prepareToPlay (48000.0, 512);
+            buffer.clear();
+            plugin.processBlock (buffer, midi);
+        });
+    };
+
+    BENCHMARK_ADVANCED ("Prepare at a new rate")
+    (Catch::Benchmark::Chronometer meter)
+    {
+        PluginProcessor plugin;
+        int run = 0;
+        meter.measure ([&] {
+            plugin.prepareToPlay ((run++ & 1) != 0 ? 44100.0 : 48000.0, 512);
+            buffer.clear();
+            plugin.processBlock (buffer, midi);
+        });
+    };
+}
+
+TEST_CASE ("Surround performance")
+{
+    juce::Random random (1);
+
+    BENCHMARK_ADVANCED ("One decoded 7.1.4 engine")
+    (Catch::Benchmark::Chronometer meter)
+    {
+        const auto layout = juce::AudioChannelSet::create7point1point4();
+        Colin::WaveVerb verb;
+        verb.setChannelLayout (2, layout.size());
+        verb.setOutputLayout (layout);
+        verb.prepareToPlay (48000.0, 512);
+        juce::AudioBuffer<float> buffer (layout.size(), 512);
+        meter.measure ([&] {
+            buffer.clear();
+            for (int i = 0; i < 512; i++)
+                buffer.setSample (0, i, random.nextFloat() - 0.5f);
+            verb.processBuffer (buffer);
+        });
+    };
+
+    BENCHMARK_ADVANCED ("Four stereo engines stacked to 7.1.4")
+    (Catch::Benchmark::Chronometer meter)
+    {
+        std::vector<std::unique_ptr<Colin::WaveVerb>> verbs;
+        for (int v = 0; v < 4; v++)
+        {
+            verbs.push_back (std::make_unique<Colin::WaveVerb>());
+            verbs.back()->prepareToPlay (48000.0, 512);
+        }
+        juce::AudioBuffer<float> buffer (2, 512);
+        meter.measure ([&] {
+            for (auto& verb : verbs)
+            {
+                buffer.clear();
+                for (int i = 0; i < 512; i++)
+                    buffer.setSample (0, i, random.nextFloat() - 0.5f);
+                verb->processBuffer (buffer);
+            }
+        });
+    };
+}
+
+TEST_CASE ("Multirate performance")
+{
+    juce::Random random (1);
+
+    // the strings stay at the host rate, only the diffuser and feedback network slow down
+    const auto measureAt96k = [&random] (Catch::Benchmark::Chronometer& meter, Colin::Multirate_Mode mode) {
+        Colin::WaveVerb verb;
+        verb.setMultirate (mode);
+        verb.prepareToPlay (96000.0, 512);
+        juce::AudioBuffer<float> buffer (2, 512);
+        meter.measure ([&] {
+            buffer.clear();
+            for (int i = 0; i < 512; i++)
+                buffer.setSample (0, i, random.nextFloat() - 0.5f);
+            verb.processBuffer (buffer);
+        });
+    };
+
+    BENCHMARK_ADVANCED ("Everything at 96 kHz")
+    (Catch::Benchmark::Chronometer meter)
+    {
+        measureAt96k (meter, Colin::Multirate_Mode::Off);
+    };
+
+    BENCHMARK_ADVANCED ("Network at half of 96 kHz")
+    (Catch::Benchmark::Chronometer meter)
+    {
+        measureAt96k (meter, Colin::Multirate_Mode::Half);
+    };
+}
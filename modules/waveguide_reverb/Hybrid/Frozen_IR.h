@@ -0,0 +1,309 @@
+#ifndef COLIN_FROZEN_IR_H
+#define COLIN_FROZEN_IR_H
+#include <atomic>
+#include <functional>
+#include <memory>
+#include "../Utility/Command_Queue.h"
+#include "IR_Cache.h"
+#include "juce_dsp/juce_dsp.h"
+
+/*
+  ==============================================================================
+
+    Frozen_IR.h
+
+    once the wet path has been static for a while its impulse response is
+    rendered in the background and the reverb switches to convolution,
+    any change switches straight back to the live network
+
+  ==============================================================================
+*/
+
+namespace Colin
+{
+
+class Frozen_IR {
+public:
+    static constexpr int BLOCK_SIZE = 512; /// longest span process() takes
+    static constexpr double FREEZE_AFTER_SECONDS = 1.0;
+    static constexpr double SETTLE_SECONDS = 0.25; /// lets the convolution swap the new response in
+    static constexpr double MAX_IR_SECONDS = 10.0;
+
+    /// fills one stereo response per input channel, runs on the renderer thread
+    using Render_Function = std::function<void(const Engine_Snapshot&, juce::AudioBuffer<float>& fromLeft, juce::AudioBuffer<float>& fromRight)>;
+
+    enum class State {
+        Live,      /// the network runs, waiting for the settings to stay put
+        Rendering, /// the network runs, the renderer is working
+        Loading,   /// the network runs, the convolutions pick up the new response
+        Frozen     /// input goes to the convolutions, the network only rings out
+    };
+
+    Frozen_IR() = default;
+    ~Frozen_IR() = default;
+
+    /// message thread, before the first setEnabled(true)
+    void setRenderFunction(Render_Function function) {
+        render = std::move(function);
+    }
+
+    /// message thread, the renderer and convolutions are only created the first time this is enabled
+    void setEnabled(const bool shouldFreeze) {
+        if(shouldFreeze && convolver == nullptr) {
+            createConvolver();
+        }
+        enabled.store(shouldFreeze, std::memory_order_relaxed);
+    }
+
+    void prepare(const double fs) {
+        sampleRate = fs;
+        leftScratch.setSize(2, BLOCK_SIZE);
+        rightScratch.setSize(2, BLOCK_SIZE);
+        if(convolver != nullptr) convolver->prepare(fs);
+        else if(enabled.load(std::memory_order_relaxed)) createConvolver(); // released while enabled
+        reset();
+    }
+
+    /// message thread while audio is stopped, drops the renderer, the loaded response and the scratch,
+    /// prepare() builds them again if freezing is still enabled (the response usually comes from the disk cache)
+    void release() {
+        convolverCreated.store(false, std::memory_order_release);
+        convolver.reset();
+        leftScratch = juce::AudioBuffer<float>();
+        rightScratch = juce::AudioBuffer<float>();
+        reset();
+    }
+
+    /// audio thread, back to the live network with nothing ringing, keeps every allocation
+    void reset() {
+        if(convolverCreated.load(std::memory_order_acquire)) {
+            convolver->fromLeft.reset();
+            convolver->fromRight.reset();
+        }
+        state = State::Live;
+        snapshot = {};
+        staticSamples = 0;
+        loadingSamples = 0;
+        liveRingSamples = 0;
+        convolutionRingSamples = 0;
+    }
+
+    /// audio thread, once per block, linear is false while anything non linear (the strings) is running
+    void update(const Engine_Snapshot& current, const bool linear, const int numSamples) {
+        liveRingSamples = juce::jmax(0, liveRingSamples - numSamples);
+        convolutionRingSamples = juce::jmax(0, convolutionRingSamples - numSamples);
+
+        const bool usable = linear && enabled.load(std::memory_order_relaxed) && convolverCreated.load(std::memory_order_acquire);
+        if(!usable || current != snapshot) {
+            if(state == State::Frozen) {
+                // the old response rings out while the network takes the input again
+                convolutionRingSamples = responseLength;
+            }
+            state = State::Live;
+            snapshot = current;
+            staticSamples = 0;
+            return;
+        }
+
+        if(state == State::Live) {
+            const int freezeAfter = juce::roundToInt(FREEZE_AFTER_SECONDS * sampleRate);
+            staticSamples = juce::jmin(staticSamples + numSamples, freezeAfter);
+            if(staticSamples == freezeAfter && convolutionRingSamples == 0) {
+                if(convolver->request(snapshot, requestId + 1)) {
+                    requestId++;
+                    state = State::Rendering;
+                }
+            }
+        }
+        else if(state == State::Rendering) {
+            const uint64_t ready = convolver->ready.load(std::memory_order_acquire);
+            if(static_cast<uint32_t>(ready >> 32) == requestId) {
+                pendingLength = static_cast<int>(ready & 0xffffffffu);
+                convolver->fromLeft.reset();
+                convolver->fromRight.reset();
+                loadingSamples = 0;
+                state = State::Loading;
+            }
+        }
+        else if(state == State::Loading) {
+            loadingSamples += numSamples;
+            const bool swapped = convolver->fromLeft.getCurrentIRSize() == pendingLength
+                && convolver->fromRight.getCurrentIRSize() == pendingLength;
+            if(swapped && loadingSamples >= juce::roundToInt(SETTLE_SECONDS * sampleRate)) {
+                // no crossfade, the network keeps ringing with the input it already had
+                responseLength = pendingLength;
+                liveRingSamples = responseLength;
+                state = State::Frozen;
+            }
+        }
+    }
+
+    /// whether the live network gets the real input, otherwise it only rings out
+    bool isFeedingLive() const {
+        return state != State::Frozen;
+    }
+
+    /// whether the live network has to run at all
+    bool isLiveRunning() const {
+        return state != State::Frozen || liveRingSamples > 0;
+    }
+
+    /// audio thread, numSamples <= BLOCK_SIZE, inR is nullptr for mono input,
+    /// returns the convolved wet signal for the span or nullptr if there is nothing to add
+    const float* const* process(const float* inL, const float* inR, const int numSamples) {
+        jassert(numSamples <= BLOCK_SIZE);
+        const bool feeding = state == State::Frozen;
+        if(!feeding && state != State::Loading && convolutionRingSamples == 0) return nullptr;
+
+        float* const* left = leftScratch.getArrayOfWritePointers();
+        float* const* right = rightScratch.getArrayOfWritePointers();
+        for(int i=0; i<numSamples; i++) {
+            // same mono handling as the live path
+            const float l = feeding ? inL[i] : 0.f;
+            const float r = feeding ? (inR != nullptr ? inR[i] : -inL[i]) : 0.f;
+            left[0][i] = l;
+            left[1][i] = l;
+            right[0][i] = r;
+            right[1][i] = r;
+        }
+
+        // true stereo, each input has its own response into both outputs
+        juce::dsp::AudioBlock<float> leftBlock = juce::dsp::AudioBlock<float>(leftScratch).getSubBlock(0, static_cast<size_t>(numSamples));
+        juce::dsp::AudioBlock<float> rightBlock = juce::dsp::AudioBlock<float>(rightScratch).getSubBlock(0, static_cast<size_t>(numSamples));
+        convolver->fromLeft.process(juce::dsp::ProcessContextReplacing<float>(leftBlock));
+        convolver->fromRight.process(juce::dsp::ProcessContextReplacing<float>(rightBlock));
+        if(state == State::Loading) return nullptr;
+
+        for(int i=0; i<numSamples; i++) {
+            left[0][i] += right[0][i];
+            left[1][i] += right[1][i];
+        }
+        return left;
+    }
+
+    State getState() const {
+        return state;
+    }
+
+    /// message thread, the convolutions' own partitions are counted as one copy of the response
+    size_t getAllocatedBytes() const {
+        size_t bytes = sizeof(float) * static_cast<size_t>(leftScratch.getNumChannels() * leftScratch.getNumSamples()
+                                                          + rightScratch.getNumChannels() * rightScratch.getNumSamples());
+        if(convolver != nullptr) {
+            bytes += sizeof(Convolver) + sizeof(float) * 4 * static_cast<size_t>(convolver->loadedLength.load(std::memory_order_relaxed));
+        }
+        return bytes;
+    }
+
+private:
+    void createConvolver() {
+        convolver = std::make_unique<Convolver>(render);
+        convolver->prepare(sampleRate);
+        convolverCreated.store(true, std::memory_order_release);
+    }
+
+    /// renderer thread and the convolutions it loads
+    class Convolver : public juce::Thread {
+    public:
+        explicit Convolver(Render_Function function)
+            : juce::Thread("WaveVerb IR Renderer"),
+              fromLeft(juce::dsp::Convolution::NonUniform {BLOCK_SIZE}, queue),
+              fromRight(juce::dsp::Convolution::NonUniform {BLOCK_SIZE}, queue),
+              render(std::move(function)) {
+            startThread();
+        }
+
+        ~Convolver() override {
+            stopThread(4000);
+        }
+
+        void prepare(const double fs) {
+            sampleRate.store(fs);
+            const juce::dsp::ProcessSpec spec {fs, static_cast<juce::uint32>(BLOCK_SIZE), 2};
+            fromLeft.prepare(spec);
+            fromRight.prepare(spec);
+        }
+
+        /// audio thread
+        bool request(const Engine_Snapshot& snapshot, const uint32_t id) {
+            return requests.push({snapshot, id});
+        }
+
+        void run() override {
+            while(!threadShouldExit()) {
+                wait(50);
+                Render_Request request;
+                bool pending = false;
+                while(requests.pop(request)) {
+                    pending = true; // only the newest one matters
+                }
+                if(!pending || render == nullptr) continue;
+
+                juce::AudioBuffer<float> left;
+                juce::AudioBuffer<float> right;
+                if(!cache->load(request.snapshot, left, right)) {
+                    render(request.snapshot, left, right);
+                    if(threadShouldExit()) return;
+                    cache->store(request.snapshot, left, right);
+                }
+
+                // consecutive responses never share a length, so the audio thread can tell when the new one is live
+                int length = left.getNumSamples();
+                if(length == lastLength) {
+                    length++;
+                    left.setSize(2, length, true, true);
+                    right.setSize(2, length, true, true);
+                }
+                lastLength = length;
+                loadedLength.store(length, std::memory_order_relaxed);
+
+                const double fs = sampleRate.load();
+                using Conv = juce::dsp::Convolution;
+                fromLeft.loadImpulseResponse(std::move(left), fs, Conv::Stereo::yes, Conv::Trim::no, Conv::Normalise::no);
+                fromRight.loadImpulseResponse(std::move(right), fs, Conv::Stereo::yes, Conv::Trim::no, Conv::Normalise::no);
+                ready.store((static_cast<uint64_t>(request.id) << 32) | static_cast<uint32_t>(length), std::memory_order_release);
+            }
+        }
+
+        juce::dsp::ConvolutionMessageQueue queue; /// shared by both convolutions, declared first
+        juce::dsp::Convolution fromLeft;
+        juce::dsp::Convolution fromRight;
+        std::atomic<uint64_t> ready {0}; /// request id << 32 | response length
+        std::atomic<int> loadedLength {0};
+
+    private:
+        struct Render_Request {
+            Engine_Snapshot snapshot;
+            uint32_t id = 0;
+        };
+
+        Render_Function render;
+        juce::SharedResourcePointer<IR_Cache> cache;
+        Command_Queue<Render_Request, 4> requests;
+        std::atomic<double> sampleRate {44100};
+        int lastLength = 0;
+    };
+
+    Render_Function render;
+    std::unique_ptr<Convolver> convolver;
+    std::atomic<bool> convolverCreated {false};
+    std::atomic<bool> enabled {false};
+
+    // audio thread
+    double sampleRate = 44100;
+    State state = State::Live;
+    Engine_Snapshot snapshot;
+    uint32_t requestId = 0;
+    int staticSamples = 0;
+    int loadingSamples = 0;
+    int pendingLength = 0;
+    int responseLength = 0;
+    int liveRingSamples = 0;
+    int convolutionRingSamples = 0;
+    juce::AudioBuffer<float> leftScratch;
+    juce::AudioBuffer<float> rightScratch;
+};
+
+}
+
+#endif
@@ -0,0 +1,94 @@
+#ifndef COLIN_IO_PATH_H
+#define COLIN_IO_PATH_H
+
+/*
+  ==============================================================================
+
+    IO_Path.h
+
+    the bus configurations the engine has its own processing path for,
+    each path is a type so the channel handling compiles out of the
+    per sample loops, the engine picks one at prepare time
+
+  ==============================================================================
+*/
+
+namespace Colin
+{
+
+/// the prebuilt paths
+enum class IO_Layout {
+    Mono = 0,       /// 1 in, 1 out
+    Mono_To_Stereo, /// 1 in, 2 out
+    Stereo,         /// 2 in, 2 out
+    Multichannel,   /// anything else, inputs folded to two sides, outputs alternate sides
+    Decoded         /// a surround or ambisonic output, every line decoded to every output (Output_Decoder)
+};
+
+/// Inputs and Outputs are 0 on the paths that take any number of channels,
+/// Outputs is -1 on the one that decodes the network's lines
+template<int Inputs, int Outputs, bool Sends = false>
+struct IO_Path {
+    static constexpr int INPUTS = Inputs;
+    static constexpr int OUTPUTS = Outputs;
+    /// one input feeds the network as left and inverted right
+    static constexpr bool MONO_IN = Inputs == 1;
+    /// one output only needs the left side of the network
+    static constexpr bool MONO_OUT = Outputs == 1;
+    /// the lines are kept per sample and decoded after the chunk instead of folded to two sides
+    static constexpr bool DECODED = Outputs < 0;
+    /// the network's input is the main input and every send bus mixed for the whole chunk first (Input_Matrix)
+    static constexpr bool SEND_BUSES = Sends;
+
+    using With_Sends = IO_Path<Inputs, Outputs, true>;
+};
+
+using Mono_Path = IO_Path<1, 1>;
+using Mono_To_Stereo_Path = IO_Path<1, 2>;
+using Stereo_Path = IO_Path<2, 2>;
+using Multichannel_Path = IO_Path<0, 0>;
+using Decoded_Path = IO_Path<0, -1>;
+
+inline IO_Layout chooseIOLayout(const int numInputs, const int numOutputs) {
+    if(numInputs == 1 && numOutputs == 1) return IO_Layout::Mono;
+    if(numInputs == 1 && numOutputs == 2) return IO_Layout::Mono_To_Stereo;
+    if(numInputs == 2 && numOutputs == 2) return IO_Layout::Stereo;
+    return IO_Layout::Multichannel;
+}
+
+/// calls function with a value of the layout's path type, one switch for a whole run of samples
+template<typename Function>
+void visitIO(const IO_Layout layout, Function&& function) {
+    switch(layout) {
+        case IO_Layout::Mono:
+            function(Mono_Path {});
+            return;
+        case IO_Layout::Mono_To_Stereo:
+            function(Mono_To_Stereo_Path {});
+            return;
+        case IO_Layout::Multichannel:
+            function(Multichannel_Path {});
+            return;
+        case IO_Layout::Decoded:
+            function(Decoded_Path {});
+            return;
+        case IO_Layout::Stereo:
+        default:
+            function(Stereo_Path {});
+            return;
+    }
+}
+
+/// the same with every path swapped for its send bus version when sends is true
+template<typename Function>
+void visitIO(const IO_Layout layout, const bool sends, Function&& function) {
+    visitIO(layout, [&](auto path) {
+        using Path = decltype(path);
+        if(sends) function(typename Path::With_Sends {});
+        else function(path);
+    });
+}
+
+}
+
+#endif
@@ -0,0 +1,291 @@
+#ifndef COLIN_IR_CACHE_H
+#define COLIN_IR_CACHE_H
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include "juce_audio_basics/juce_audio_basics.h"
+#include "juce_core/juce_core.h"
+#include "../Utility/Sample_Storage.h"
+
+/*
+  ==============================================================================
+
+    IR_Cache.h
+
+    rendered impulse responses are kept on disk, one memory mappable file
+    per setting, so every instance (and the next session) can load a
+    response instead of rendering it again, what's shared is the render
+    and the page cache behind the file, not the samples in memory: each
+    instance copies its hit out, juce::dsp::Convolution partitions it
+    into its own spectra anyway
+
+  ==============================================================================
+*/
+
+namespace Colin
+{
+
+/// everything the wet path's impulse response depends on
+struct Engine_Snapshot {
+    double sampleRate = 0;
+    float roomSizeMS = 0.f;
+    float rt60MS = 0.f;
+    float blend = 0.f;
+    int modelType = 0;
+    int multirate = 0;
+    int layout = 0;
+    uint32_t seed = 0;
+
+    bool operator==(const Engine_Snapshot& other) const {
+        return sampleRate == other.sampleRate && roomSizeMS == other.roomSizeMS && rt60MS == other.rt60MS
+            && blend == other.blend && modelType == other.modelType && multirate == other.multirate && layout == other.layout
+            && seed == other.seed;
+    }
+
+    bool operator!=(const Engine_Snapshot& other) const {
+        return !(*this == other);
+    }
+};
+
+/// a snapshot quantised to steps nobody can hear, so nearby settings share a file
+struct IR_Key {
+    /// goes up with every change to the engine that changes what a snapshot renders,
+    /// so responses from an older build are rendered again instead of loaded
+    static constexpr uint32_t RENDER_VERSION = 1;
+
+    uint32_t seed = 0;
+    int32_t sampleRate = 0;  /// Hz
+    int32_t roomSize = 0;    /// 0.1 ms
+    int32_t rt60 = 0;        /// ms
+    int32_t blend = 0;       /// 1/1000
+    int32_t modelType = 0;
+    int32_t multirate = 0;   /// the graph layout in the bits above the lowest 8
+    uint32_t render = 0;     /// RENDER_VERSION above the lowest 8 bits, the delay line precision in them
+
+    static IR_Key from(const Engine_Snapshot& snapshot) {
+        IR_Key key;
+        key.seed = snapshot.seed;
+        key.sampleRate = static_cast<int32_t>(std::lround(snapshot.sampleRate));
+        key.roomSize = static_cast<int32_t>(std::lround(snapshot.roomSizeMS * 10.f));
+        key.rt60 = static_cast<int32_t>(std::lround(snapshot.rt60MS));
+        key.blend = static_cast<int32_t>(std::lround(snapshot.blend * 1000.f));
+        key.modelType = snapshot.modelType;
+        // the layout shares a field so serial graph files keep their keys
+        key.multirate = snapshot.multirate | (snapshot.layout << 8);
+        // the reduced precision lines render a slightly different response
+        key.render = (RENDER_VERSION << 8) | static_cast<uint32_t>(COLIN_DELAY_PRECISION);
+        return key;
+    }
+
+    /// 64 bit FNV-1a over the fields, names the file
+    uint64_t hash() const {
+        const uint32_t fields[] = {seed, static_cast<uint32_t>(sampleRate), static_cast<uint32_t>(roomSize), static_cast<uint32_t>(rt60),
+                                   static_cast<uint32_t>(blend), static_cast<uint32_t>(modelType), static_cast<uint32_t>(multirate), render};
+        uint64_t h = 14695981039346656037ull;
+        for(const uint32_t field : fields) {
+            for(int byte=0; byte<4; byte++) {
+                h ^= (field >> (8 * byte)) & 0xffu;
+                h *= 1099511628211ull;
+            }
+        }
+        return h;
+    }
+
+    bool operator==(const IR_Key& other) const {
+        return seed == other.seed && sampleRate == other.sampleRate && roomSize == other.roomSize && rt60 == other.rt60
+            && blend == other.blend && modelType == other.modelType && multirate == other.multirate && render == other.render;
+    }
+};
+
+/// starts every cache file, the channels follow as raw floats at 64 byte aligned offsets
+struct IR_File_Header {
+    static constexpr uint32_t VERSION = 2;
+    static constexpr int NUM_CHANNELS = 4; /// left to left, left to right, right to left, right to right
+    static constexpr uint64_t ALIGNMENT = 64;
+
+    char magic[4] = {'W', 'V', 'I', 'R'};
+    uint32_t version = VERSION;
+    uint32_t length = 0;      /// samples per channel
+    uint32_t numChannels = NUM_CHANNELS;
+    IR_Key key;
+    uint64_t channelOffsets[NUM_CHANNELS] = {0}; /// byte offset of each channel from the start of the file
+
+    static uint64_t align(const uint64_t offset) {
+        return (offset + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+    }
+};
+
+static_assert(sizeof(IR_Key) == 32, "the key is part of the file format");
+static_assert(sizeof(IR_File_Header) == 80, "the header is part of the file format");
+
+/// one per process (juce::SharedResourcePointer), only touched by the renderer threads
+class IR_Cache {
+public:
+    static constexpr juce::int64 DEFAULT_SIZE_LIMIT = 256 * 1024 * 1024;
+
+    IR_Cache() {
+        setDirectory(juce::File::getSpecialLocation(juce::File::userApplicationDataDirectory)
+                         .getChildFile("Colin's Plugins").getChildFile("WaveguideReverb").getChildFile("IR Cache"));
+    }
+    ~IR_Cache() = default;
+
+    void setDirectory(const juce::File& newDirectory) {
+        const juce::ScopedLock lock(cacheLock);
+        directory = newDirectory;
+    }
+
+    juce::File getDirectory() const {
+        const juce::ScopedLock lock(cacheLock);
+        return directory;
+    }
+
+    /// total bytes on disk before the least recently used files go
+    void setSizeLimit(const juce::int64 bytes) {
+        const juce::ScopedLock lock(cacheLock);
+        sizeLimit = bytes;
+        evict();
+    }
+
+    /// maps the cached response for snapshot read only, copies it into the buffers and unmaps it again,
+    /// false if there is none
+    bool load(const Engine_Snapshot& snapshot, juce::AudioBuffer<float>& fromLeft, juce::AudioBuffer<float>& fromRight) {
+        const IR_Key key = IR_Key::from(snapshot);
+        const juce::File file = getFile(key);
+        if(!file.existsAsFile()) return false;
+
+        bool valid = false;
+        {
+            const juce::MemoryMappedFile mapped(file, juce::MemoryMappedFile::readOnly);
+            const auto* data = static_cast<const char*>(mapped.getData());
+            const size_t size = mapped.getSize();
+            IR_File_Header header;
+            if(data != nullptr && size >= sizeof(IR_File_Header)) {
+                std::memcpy(&header, data, sizeof(IR_File_Header));
+                valid = isValid(header, key, size);
+            }
+            if(valid) {
+                const int length = static_cast<int>(header.length);
+                fromLeft.setSize(2, length, false, false, true);
+                fromRight.setSize(2, length, false, false, true);
+                float* const destinations[IR_File_Header::NUM_CHANNELS] = {fromLeft.getWritePointer(0), fromLeft.getWritePointer(1),
+                                                                           fromRight.getWritePointer(0), fromRight.getWritePointer(1)};
+                for(int ch=0; ch<IR_File_Header::NUM_CHANNELS; ch++) {
+                    std::memcpy(destinations[ch], data + header.channelOffsets[ch], sizeof(float) * header.length);
+                }
+            }
+        }
+
+        const juce::ScopedLock lock(cacheLock);
+        if(!valid) {
+            // truncated, from another version or a hash collision, it gets rendered again
+            file.deleteFile();
+            return false;
+        }
+        // the modification time is the lru stamp, access times are often not kept
+        file.setLastModificationTime(juce::Time::getCurrentTime());
+        return true;
+    }
+
+    /// writes the response next to its final name and moves it into place, so readers never see half a file
+    bool store(const Engine_Snapshot& snapshot, const juce::AudioBuffer<float>& fromLeft, const juce::AudioBuffer<float>& fromRight) {
+        jassert(fromLeft.getNumChannels() == 2 && fromRight.getNumChannels() == 2);
+        jassert(fromLeft.getNumSamples() == fromRight.getNumSamples());
+
+        IR_File_Header header;
+        header.key = IR_Key::from(snapshot);
+        header.length = static_cast<uint32_t>(fromLeft.getNumSamples());
+        const uint64_t channelBytes = sizeof(float) * header.length;
+        uint64_t offset = IR_File_Header::align(sizeof(IR_File_Header));
+        for(int ch=0; ch<IR_File_Header::NUM_CHANNELS; ch++) {
+            header.channelOffsets[ch] = offset;
+            offset = IR_File_Header::align(offset + channelBytes);
+        }
+        const juce::int64 fileSize = static_cast<juce::int64>(offset);
+
+        const juce::ScopedLock lock(cacheLock);
+        if(fileSize > sizeLimit || !directory.createDirectory()) return false;
+
+        const juce::File file = getFile(header.key);
+        juce::TemporaryFile temporary(file);
+        {
+            juce::FileOutputStream stream(temporary.getFile());
+            if(!stream.openedOk()) return false;
+            const char padding[IR_File_Header::ALIGNMENT] = {0};
+            const float* const sources[IR_File_Header::NUM_CHANNELS] = {fromLeft.getReadPointer(0), fromLeft.getReadPointer(1),
+                                                                       fromRight.getReadPointer(0), fromRight.getReadPointer(1)};
+            bool written = stream.write(&header, sizeof(IR_File_Header));
+            uint64_t position = sizeof(IR_File_Header);
+            for(int ch=0; ch<IR_File_Header::NUM_CHANNELS; ch++) {
+                written = written && stream.write(padding, static_cast<size_t>(header.channelOffsets[ch] - position));
+                written = written && stream.write(sources[ch], static_cast<size_t>(channelBytes));
+                position = header.channelOffsets[ch] + channelBytes;
+            }
+            written = written && stream.write(padding, static_cast<size_t>(offset - position));
+            stream.flush();
+            if(!written) return false;
+        }
+        if(!temporary.overwriteTargetFileWithTemporary()) return false;
+
+        evict();
+        return true;
+    }
+
+    /// bytes currently on disk
+    juce::int64 getTotalSize() const {
+        const juce::ScopedLock lock(cacheLock);
+        juce::int64 total = 0;
+        for(const auto& file : findFiles()) {
+            total += file.getSize();
+        }
+        return total;
+    }
+
+    juce::File getFile(const IR_Key& key) const {
+        const juce::ScopedLock lock(cacheLock);
+        return directory.getChildFile("ir_" + juce::String::toHexString(static_cast<juce::int64>(key.hash())) + EXTENSION);
+    }
+
+private:
+    static constexpr const char* EXTENSION = ".wvir";
+
+    static bool isValid(const IR_File_Header& header, const IR_Key& key, const size_t size) {
+        if(std::memcmp(header.magic, "WVIR", 4) != 0 || header.version != IR_File_Header::VERSION) return false;
+        if(header.numChannels != IR_File_Header::NUM_CHANNELS || header.length == 0 || !(header.key == key)) return false;
+        for(const uint64_t offset : header.channelOffsets) {
+            if(offset % sizeof(float) != 0 || offset + sizeof(float) * header.length > size) return false;
+        }
+        return true;
+    }
+
+    juce::Array<juce::File> findFiles() const {
+        return directory.findChildFiles(juce::File::findFiles, false, juce::String("*") + EXTENSION);
+    }
+
+    /// deletes the least recently used files until the cache fits, caller holds the lock
+    void evict() {
+        auto files = findFiles();
+        juce::int64 total = 0;
+        for(const auto& file : files) {
+            total += file.getSize();
+        }
+        if(total <= sizeLimit) return;
+
+        std::sort(files.begin(), files.end(), [](const juce::File& a, const juce::File& b) {
+            return a.getLastModificationTime() < b.getLastModificationTime();
+        });
+        for(const auto& file : files) {
+            if(total <= sizeLimit) break;
+            const juce::int64 size = file.getSize();
+            if(file.deleteFile()) total -= size;
+        }
+    }
+
+    juce::CriticalSection cacheLock;
+    juce::File directory;
+    juce::int64 sizeLimit = DEFAULT_SIZE_LIMIT;
+};
+
+}
+
+#endif
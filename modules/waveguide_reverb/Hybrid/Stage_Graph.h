@@ -0,0 +1,148 @@
+#ifndef COLIN_STAGE_GRAPH_H
+#define COLIN_STAGE_GRAPH_H
+#include "../Reverb/Frame.h"
+
+/*
+  ==============================================================================
+
+    Stage_Graph.h
+
+    the order the wet path's stages run in, declared as types so each
+    layout compiles to straight calls, the engine supplies what each
+    stage does (WaveVerb::runStage) and picks one layout at prepare time
+
+  ==============================================================================
+*/
+
+namespace Colin
+{
+
+/// the prebuilt graphs
+enum class Graph_Layout {
+    Serial = 0,         /// strings into the diffuser's output, then the feedback network
+    Strings_After_Late, /// the feedback network excites the strings
+    Parallel            /// strings, diffuser and feedback network side by side
+};
+
+/// where a stage reads from and writes to
+enum class Stage_Slot {
+    Input = 0,
+    Strings,
+    Early,
+    Late,
+    Out,
+    Count
+};
+
+/// the frames of one sample as it moves through a graph
+struct Stage_Frame {
+    data slots[static_cast<int>(Stage_Slot::Count)];
+
+    data& operator[](const Stage_Slot slot) {
+        return slots[static_cast<int>(slot)];
+    }
+};
+
+/// the string bank excited by from, always writes Strings
+template<Stage_Slot From>
+struct Strings_Stage {};
+
+template<Stage_Slot From, Stage_Slot To>
+struct Diffusion_Stage {};
+
+/// from mixed with Strings by the blend control, just from when there is no model
+template<Stage_Slot From, Stage_Slot To>
+struct Blend_Stage {};
+
+template<Stage_Slot From, Stage_Slot To>
+struct Feedback_Stage {};
+
+template<Stage_Slot A, Stage_Slot B, Stage_Slot To>
+struct Sum_Stage {};
+
+/// stages run left to right, every graph leaves its result in Out
+template<typename... Stages>
+struct Stage_Graph {
+    template<typename Engine>
+    static void process(Engine& engine, Stage_Frame& frame) {
+        (engine.runStage(Stages {}, frame), ...);
+    }
+};
+
+/// a graph that starts by exciting the strings from the input can run the strings at the
+/// host rate and the rest (Late) at the reduced rate, any other only runs at one rate
+template<typename Graph>
+struct Graph_Split {
+    static constexpr bool HOST_RATE_STRINGS = false;
+    using Late = Graph;
+};
+
+template<typename... Rest>
+struct Graph_Split<Stage_Graph<Strings_Stage<Stage_Slot::Input>, Rest...>> {
+    static constexpr bool HOST_RATE_STRINGS = true;
+    using Late = Stage_Graph<Rest...>;
+};
+
+/// a graph whose strings and diffuser both start from the input can run them on their own
+/// threads ahead of the rest (Late), see Stage_Pipeline
+template<typename Graph>
+struct Pipeline_Split {
+    static constexpr bool PIPELINED = false;
+    static constexpr Stage_Slot DIFFUSION_SLOT = Stage_Slot::Early;
+    using Late = Graph;
+};
+
+template<Stage_Slot To, typename... Rest>
+struct Pipeline_Split<Stage_Graph<Strings_Stage<Stage_Slot::Input>, Diffusion_Stage<Stage_Slot::Input, To>, Rest...>> {
+    static constexpr bool PIPELINED = true;
+    static constexpr Stage_Slot DIFFUSION_SLOT = To;
+    using Late = Stage_Graph<Rest...>;
+};
+
+using Serial_Graph = Stage_Graph<
+    Strings_Stage<Stage_Slot::Input>,
+    Diffusion_Stage<Stage_Slot::Input, Stage_Slot::Early>,
+    Blend_Stage<Stage_Slot::Early, Stage_Slot::Early>,
+    Feedback_Stage<Stage_Slot::Early, Stage_Slot::Out>>;
+
+using Strings_After_Late_Graph = Stage_Graph<
+    Diffusion_Stage<Stage_Slot::Input, Stage_Slot::Early>,
+    Feedback_Stage<Stage_Slot::Early, Stage_Slot::Late>,
+    Strings_Stage<Stage_Slot::Late>,
+    Blend_Stage<Stage_Slot::Late, Stage_Slot::Out>>;
+
+using Parallel_Graph = Stage_Graph<
+    Strings_Stage<Stage_Slot::Input>,
+    Diffusion_Stage<Stage_Slot::Input, Stage_Slot::Early>,
+    Feedback_Stage<Stage_Slot::Input, Stage_Slot::Late>,
+    Sum_Stage<Stage_Slot::Early, Stage_Slot::Late, Stage_Slot::Early>,
+    Blend_Stage<Stage_Slot::Early, Stage_Slot::Out>>;
+
+/// calls function with a value of the layout's graph type, one switch for a whole run of samples
+template<typename Function>
+void visitGraph(const Graph_Layout layout, Function&& function) {
+    switch(layout) {
+        case Graph_Layout::Strings_After_Late:
+            function(Strings_After_Late_Graph {});
+            return;
+        case Graph_Layout::Parallel:
+            function(Parallel_Graph {});
+            return;
+        case Graph_Layout::Serial:
+        default:
+            function(Serial_Graph {});
+            return;
+    }
+}
+
+inline bool hasHostRateStrings(const Graph_Layout layout) {
+    bool hostRate = false;
+    visitGraph(layout, [&hostRate](auto graph) {
+        hostRate = Graph_Split<decltype(graph)>::HOST_RATE_STRINGS;
+    });
+    return hostRate;
+}
+
+}
+
+#endif
@@ -0,0 +1,246 @@
+#ifndef COLIN_STAGE_PIPELINE_H
+#define COLIN_STAGE_PIPELINE_H
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <optional>
+#include <vector>
+#include "juce_core/juce_core.h"
+
+/*
+  ==============================================================================
+
+    Stage_Pipeline.h
+
+    offline rendering only, the stages that only depend on the input (the
+    strings and the diffuser) run a sub block ahead of the stage that needs
+    both, which runs on the calling thread, every stage keeps its own state
+    and sees its samples in order so the output is the same as running them
+    one after another
+
+    the workers come from one pool shared by every instance in the process,
+    a stage no worker has picked up yet is taken back and run by the caller
+
+  ==============================================================================
+*/
+
+namespace Colin
+{
+
+class Worker_Pool {
+public:
+    /// processes samples [start, end) of the current run
+    using Job = void (*)(void* context, int start, int end);
+
+    struct Task {
+        Job job = nullptr;
+        void* context = nullptr;
+        int length = 0;
+        int subBlock = 64; /// how often progress is published
+        std::atomic<int> progress {0};
+        juce::WaitableEvent advanced; /// signalled after every sub block and once the task is let go
+
+        void execute() {
+            for(int start = 0; start < length; start += subBlock) {
+                const int end = std::min(start + subBlock, length);
+                job(context, start, end);
+                progress.store(end, std::memory_order_release);
+                advanced.signal();
+            }
+        }
+
+    private:
+        friend class Worker_Pool;
+        // guarded by the pool's lock
+        bool queued = false;
+        bool running = false;
+        Task* next = nullptr;
+    };
+
+    /// one worker per core, leaving one for the thread that submits
+    Worker_Pool() {
+        const int numWorkers = juce::jmax(1, juce::SystemStats::getNumCpus() - 1);
+        for(int i = 0; i < numWorkers; i++) {
+            workers.push_back(std::make_unique<Worker>(*this));
+        }
+    }
+
+    ~Worker_Pool() {
+        for(auto& worker : workers) {
+            worker->signalThreadShouldExit();
+        }
+        work.signal();
+        workers.clear();
+    }
+
+    int getNumWorkers() const {
+        return static_cast<int>(workers.size());
+    }
+
+    void submit(Task& task) {
+        const juce::ScopedLock lock(tasksLock);
+        task.progress.store(0, std::memory_order_relaxed);
+        task.queued = true;
+        task.next = nullptr;
+        (tail == nullptr ? head : tail->next) = &task;
+        tail = &task;
+        work.signal();
+    }
+
+    /// true when no worker had started the task, it's the caller's to run now
+    bool reclaim(Task& task) {
+        const juce::ScopedLock lock(tasksLock);
+        if(!task.queued) return false;
+        Task* previous = nullptr;
+        for(Task* t = head; t != nullptr; previous = t, t = t->next) {
+            if(t != &task) continue;
+            (previous == nullptr ? head : previous->next) = t->next;
+            if(tail == t) tail = previous;
+            break;
+        }
+        task.queued = false;
+        return true;
+    }
+
+    /// false once no worker will touch the task again
+    bool isBusy(Task& task) {
+        const juce::ScopedLock lock(tasksLock);
+        return task.queued || task.running;
+    }
+
+private:
+    class Worker : public juce::Thread {
+    public:
+        explicit Worker(Worker_Pool& owner) : juce::Thread("WaveVerb Stage Worker"), pool(owner) {
+            startThread();
+        }
+
+        ~Worker() override {
+            stopThread(1000);
+        }
+
+        void run() override {
+            while(!threadShouldExit()) {
+                if(Task* task = pool.pop()) {
+                    task->execute();
+                    pool.finish(*task);
+                }
+                else {
+                    pool.work.wait(100);
+                }
+            }
+            // wake the next one so they all see the exit
+            pool.work.signal();
+        }
+
+    private:
+        Worker_Pool& pool;
+    };
+
+    Task* pop() {
+        const juce::ScopedLock lock(tasksLock);
+        Task* task = head;
+        if(task == nullptr) return nullptr;
+        head = task->next;
+        if(head == nullptr) tail = nullptr;
+        task->queued = false;
+        task->running = true;
+        // more waiting, wake another worker
+        if(head != nullptr) work.signal();
+        return task;
+    }
+
+    void finish(Task& task) {
+        const juce::ScopedLock lock(tasksLock);
+        task.running = false;
+        task.advanced.signal();
+    }
+
+    juce::CriticalSection tasksLock;
+    Task* head = nullptr;
+    Task* tail = nullptr;
+    juce::WaitableEvent work;
+    std::vector<std::unique_ptr<Worker>> workers;
+};
+
+class Stage_Pipeline {
+public:
+    static constexpr int SUB_BLOCK = 64; /// how far the last stage trails the workers
+
+    using Job = Worker_Pool::Job;
+
+    ~Stage_Pipeline() {
+        stop();
+    }
+
+    /// message thread, e.g. from prepareToPlay, the first instance to start creates the pool
+    void start() {
+        if(!pool.has_value()) pool.emplace();
+    }
+
+    /// the last instance to stop lets the pool go
+    void stop() {
+        pool.reset();
+    }
+
+    bool isRunning() const {
+        return pool.has_value();
+    }
+
+    /// first and second on the workers, last here once both are past the samples it needs,
+    /// without workers the three take turns a sub block at a time
+    void run(const int numSamples, Job first, Job second, Job last, void* context) {
+        if(!isRunning()) {
+            for(int start = 0; start < numSamples; start += SUB_BLOCK) {
+                const int end = std::min(start + SUB_BLOCK, numSamples);
+                first(context, start, end);
+                second(context, start, end);
+                last(context, start, end);
+            }
+            return;
+        }
+        Worker_Pool& workers = pool->get();
+        Worker_Pool::Task* const tasks[] = {&firstTask, &secondTask};
+        firstTask.job = first;
+        secondTask.job = second;
+        for(auto* task : tasks) {
+            task->context = context;
+            task->length = numSamples;
+            task->subBlock = SUB_BLOCK;
+            workers.submit(*task);
+        }
+        for(int start = 0; start < numSamples; start += SUB_BLOCK) {
+            const int end = std::min(start + SUB_BLOCK, numSamples);
+            for(auto* task : tasks) {
+                waitFor(workers, *task, end);
+            }
+            last(context, start, end);
+        }
+        // a worker may still be signalling, the tasks are reused next block
+        for(auto* task : tasks) {
+            while(workers.isBusy(*task)) {
+                task->advanced.wait(100);
+            }
+        }
+    }
+
+private:
+    /// blocks until the task is past sample, running it here if every worker is busy elsewhere
+    static void waitFor(Worker_Pool& workers, Worker_Pool::Task& task, const int sample) {
+        while(task.progress.load(std::memory_order_acquire) < sample) {
+            if(workers.reclaim(task)) {
+                task.execute();
+            }
+            else {
+                task.advanced.wait(100);
+            }
+        }
+    }
+
+    std::optional<juce::SharedResourcePointer<Worker_Pool>> pool;
+    Worker_Pool::Task firstTask, secondTask;
+};
+
+}
+
+#endif
@@ -3,8 +3,24 @@
 
 #include <math.h>
 #include "../Reverb/Delay.h"
+#include "../Reverb/Input_Matrix.h"
+#include "../Reverb/Multirate.h"
+#include "../Reverb/Output_Decoder.h"
 #include "../Utility/Biquad.h"
 #include "../Waveguide/String.h"
+#include "../Waveguide/Tuning.h"
+#include "../Waveguide/Voice_Allocator.h"
+#include "../Utility/Health_Monitor.h"
+#include "../Utility/Load_Governor.h"
+#include "../Utility/Memory_Tracker.h"
+#include "../Utility/Page_Residency.h"
+#include "../Utility/Stage_Gate.h"
+#include "../Utility/Table_Registry.h"
+#include "../Utility/Update_Scheduler.h"
+#include "Frozen_IR.h"
+#include "IO_Path.h"
+#include "Stage_Graph.h"
+#include "Stage_Pipeline.h"
 #include "juce_audio_basics/juce_audio_basics.h"
 
 /*
@@ -51,102 +67,511 @@ namespace Colin
         Minor_Seven
     };
 
+    /// rate the diffuser and feedback network run at, Auto picks one from the host rate
+    enum class Multirate_Mode {
+        Off = 0,
+        Half,
+        Quarter,
+        Auto
+    };
+
+    /// the settings that trade cpu for quality, a host picks one for live playback and one for bounces
+    struct Render_Profile {
+        Multirate_Mode multirate = Multirate_Mode::Off;
+        bool compact = false;
+        Prune_Policy prunePolicy = Prune_Policy::Clear;
+        float pruneThresholdDB = -80.f;
+        bool pipelining = false;
+        float updateBudgetUS = 0.f; /// per block for retuning and rebuilding, 0 applies changes at once
+
+        /// the reverb drops to a lower rate above 88.2 kHz, idle stages keep their state
+        /// and expensive parameter changes are spread over the following blocks
+        static Render_Profile live() {
+            Render_Profile profile;
+            profile.multirate = Multirate_Mode::Auto;
+            profile.prunePolicy = Prune_Policy::Keep_Warm;
+            profile.updateBudgetUS = 100.f;
+            return profile;
+        }
+
+        /// everything at the host rate, stages only stop far below audibility and restart from
+        /// silence, so every render of the same input is identical
+        static Render_Profile bounce() {
+            Render_Profile profile;
+            profile.pruneThresholdDB = -120.f;
+            profile.pipelining = true;
+            return profile;
+        }
+    };
+
 class WaveVerb {
 public:
-    WaveVerb() = default;
-    ~WaveVerb() = default;
+    WaveVerb() {
+        frozen.setRenderFunction(&WaveVerb::renderImpulseResponse);
+        voiceJob = updates.addJob([](void* verb, const int voice) {
+            return static_cast<WaveVerb*>(verb)->stageVoice(voice);
+        }, [](void* verb) {
+            // every voice the job worked out changes on the same sample
+            auto& v = *static_cast<WaveVerb*>(verb);
+            v.commitVoices(v.stagedVoices);
+        }, this, Voice_Allocator::NUM_VOICES);
+        roomJob = updates.addJob([](void* verb, const int step) {
+            auto& v = *static_cast<WaveVerb*>(verb);
+            v.diffusion.configureStep(step, v.roomSizeMS, v.reverbRate, v.topologySeed);
+            return true;
+        }, [](void* verb) {
+            // the rebuilt diffuser, the loop length and its decay change together
+            auto& v = *static_cast<WaveVerb*>(verb);
+            v.diffusion.swapSteps();
+            v.feedback.setTime(v.roomSizeMS);
+            v.updateDecay();
+        }, this, Diffuser::NUM_STEPS);
+    }
+    ~WaveVerb() {
+        memory->update(reportedBytes, 0);
+    }
 
-    void prepareToPlay(const double fs) {
+    /// hosts call this on every transport start, if nothing it depends on changed only the state is cleared,
+    /// otherwise the existing allocations are reused wherever they are big enough
+    void prepareToPlay(const double fs, const int maxBlockSize = Frozen_IR::BLOCK_SIZE) {
+        // setRenderProfile came after any switch that was still waiting
+        pendingProfile.waiting.store(false, std::memory_order_relaxed);
+        updates.setBudget(updateBudgetUS);
+        updates.finishAll();
+        preparePipeline();
+        governor.prepare(fs, maxBlockSize);
+        applyQualityTier(Quality_Tier::Full);
+        activeInputs = inputChannels;
+        activeOutputs = outputChannels;
+        decoder = requestedDecoder;
+        const bool decoded = decoder.isActive() && outputChannels == decoder.getNumOutputs();
+        activeIO = decoded ? IO_Layout::Decoded : chooseIOLayout(inputChannels, outputChannels);
+        prepareDecoder();
+        prepareSends(fs);
+        const int lowest = compactRequested ? getCompactLowestNote() : Waveguide_String::LOWEST_NOTE;
+        const Prepared_Config config {fs, maxBlockSize, multirateMode, lowest, topologySeed, prefaultRequested, lockRequested, graphLayout, decoded, activeSends};
+        // a midi note played since that the compact strings have no room for needs them rebuilt
+        if(config == prepared && lowestNote <= getCompactLowestNote()) {
+            clearState();
+            return;
+        }
+        prepared = config;
         sampleRate = fs;
-        diffusion.prepareToPlay(150.f, fs);
-        feedback.prepareToPlay(fs, 150.f, 0.85f);
-        strings.prepareToPlay(fs);
-        updateFrequencies();
-        setSize(roomSizeMS, rt60MS / 1000.f);
+        tuningTable = tables->get(fs);
+        // every root and chord for this rate, picked from by setRoot and setChord
+        tuningBank = banks->get(fs);
+        currentTuning = &tuningBank->get(rootNote, chordType);
+        activeLayout = graphLayout;
+        prepareMultirate(fs);
+        if(prefaultRequested) {
+            // sized for the largest room up front, so a room size change never allocates
+            diffusion.reserve(MAX_ROOM_SIZE_MS, reverbRate);
+            feedback.reserve(reverbRate, MAX_ROOM_SIZE_MS);
+        }
+        diffusion.prepareToPlay(roomSizeMS, reverbRate, topologySeed);
+        feedback.prepareToPlay(reverbRate, roomSizeMS, 0.85f);
+        lowestNote = lowest;
+        prepareStrings(fs);
+        // the lines were rebuilt, so decay and damping have to be worked out again
+        const float rt = rt60MS;
+        rt60MS = -1.f;
+        setSize(roomSizeMS, rt / 1000.f);
         matrix.cheapEnergyCrossfade(dryWet, outCoeff, inCoeff);
+        stringsGate.prepare(fs);
+        diffusionGate.prepare(reverbRate);
+        feedbackGate.prepare(reverbRate);
+        frozen.prepare(fs);
+        updateMemoryReport();
+        prefault();
     }
 
-    void processBuffer(juce::AudioBuffer<float>& buffer) {
-        const int numChannels = buffer.getNumChannels();
+    /// splits the block at every midi timestamp so events land on their exact sample,
+    /// the span bookkeeping is per event rather than per sample
+    void processBuffer(juce::AudioBuffer<float>& buffer, const juce::MidiBuffer& midiMessages) {
         const int numSamples = buffer.getNumSamples();
-
-        for(int sample = 0; sample < numSamples; sample++) {
-            float sampleL = 0.f;
-            float sampleR = 0.f;
-            if(numChannels == 1) {
-                // mono configuration
-                sampleL = buffer.getSample(0, sample);
-                sampleR = -1.f * sampleL;
-            }
-            else {
-                // stereo configuration
-                sampleL = buffer.getSample(0, sample);
-                sampleR = buffer.getSample(1, sample);
+        int position = 0;
+        faults.begin();
+        governor.begin();
+        beginBlock(numSamples);
+        for(const auto metadata : midiMessages) {
+            const int eventPosition = juce::jlimit(0, numSamples, metadata.samplePosition);
+            if(eventPosition > position) {
+                processSpan(buffer, position, eventPosition - position);
+                position = eventPosition;
             }
+            handleMidiEvent(metadata.getMessage());
+        }
+        if(position < numSamples) {
+            processSpan(buffer, position, numSamples - position);
+        }
+        checkHealth(numSamples);
+        governor.end(numSamples);
+        faults.end();
+    }
 
-            data input = matrix.stereoToMulti(sampleL, sampleR);
-            data mout;
-            if(modelType == ModelType::String) {
-                mout = strings.process(input);
-            }
-            //mout.scale(blendOutCoeff);
-            //input = matrix.combine(input, mout);
-            data dout = diffusion.process(input);
-            if(modelType != ModelType::None) {
-                dout = matrix.intermix(dout, mout, blendInCoeff, blendOutCoeff);
+    void processBuffer(juce::AudioBuffer<float>& buffer) {
+        faults.begin();
+        governor.begin();
+        beginBlock(buffer.getNumSamples());
+        processSpan(buffer, 0, buffer.getNumSamples());
+        checkHealth(buffer.getNumSamples());
+        governor.end(buffer.getNumSamples());
+        faults.end();
+    }
+
+    /// renders [startSample, startSample + numSamples), any sub-block event source splits here
+    void processSpan(juce::AudioBuffer<float>& buffer, const int startSample, const int numSamples) {
+        IO_Layout layout = activeIO;
+        int ins = activeInputs;
+        int outs = activeOutputs;
+        const int numChannels = buffer.getNumChannels();
+        if(numChannels < juce::jmax(ins, outs)) {
+            // narrower than what was prepared for, only the channels that are there get used
+            ins = juce::jmin(ins, numChannels);
+            outs = juce::jmin(outs, numChannels);
+            layout = chooseIOLayout(ins, outs);
+        }
+        // a send that isn't in the buffer turns every send off rather than reading past it
+        const bool sending = activeSends && numChannels >= sends.getRequiredChannels();
+        visitIO(layout, sending, [&](auto path) {
+            // the convolution works on whole chunks, so long spans are cut to its block size
+            for(int offset = 0; offset < numSamples; offset += Frozen_IR::BLOCK_SIZE) {
+                processChunk<decltype(path)>(buffer, startSample + offset, juce::jmin(Frozen_IR::BLOCK_SIZE, numSamples - offset), ins, outs);
             }
-            data fout = feedback.process(dout);
+        });
+    }
 
-            //data mixed = matrix.intermix(fout, mout, blendInCoeff, blendOutCoeff);
-            float outSampleL = 0;
-            float outSampleR = 0;
-            matrix.multiToStereo(fout, outSampleL, outSampleR);
+    /// the wet path for one input frame, before output gain and dry/wet mixing
+    void processWetSample(const float sampleL, const float sampleR, float& outL, float& outR) {
+        visitGraph(activeLayout, [&](auto graph) {
+            processWetSample<decltype(graph)>(sampleL, sampleR, outL, outR);
+        });
+    }
 
-            outSampleL *= outputGain;
-            outSampleR *= outputGain;
-            float left = (outSampleL * outCoeff) + (sampleL * inCoeff);
-            float right = (outSampleR * outCoeff) + (sampleR * inCoeff);
-            left = softClip(left);
-            right = softClip(right);
-            jassert(std::abs(left) <= 1 || std::abs(right) <= 1);
-            buffer.setSample(0, sample, left);
-            buffer.setSample(1, sample, right);
-        }
+    /// message thread, takes effect at the next prepareToPlay, layouts whose strings
+    /// don't start from the input run everything at the host rate
+    void setGraphLayout(const Graph_Layout layout) {
+        graphLayout = layout;
+    }
+
+    /// the layout the last prepareToPlay built
+    Graph_Layout getGraphLayout() const {
+        return activeLayout;
+    }
+
+    /// message thread, takes effect at the next prepareToPlay, the main bus channel counts, processBuffer
+    /// reads the inputs from the buffer's first channels and writes the outputs over them
+    void setChannelLayout(const int inputs, const int outputs) {
+        inputChannels = juce::jmax(0, inputs);
+        outputChannels = juce::jmax(1, outputs);
+    }
+
+    /// the path the last prepareToPlay picked
+    IO_Layout getIOLayout() const {
+        return activeIO;
+    }
+
+    /// message thread, takes effect at the next prepareToPlay, a layout Output_Decoder supports with as many
+    /// channels as setChannelLayout's outputs gets every line decoded to it instead of the stereo fold down,
+    /// decoded outputs run everything at the host rate and never freeze (the frozen response is stereo)
+    void setOutputLayout(const juce::AudioChannelSet& layout) {
+        requestedDecoder.build(layout);
+    }
+
+    /// message thread, takes effect at the next prepareToPlay, send bus 1 to Input_Matrix::MAX_BUSES - 1 reads
+    /// numChannels (0 to 2, 0 turns it off) from firstChannel of the buffer, every bus in use shares the
+    /// diffuser and the feedback network with the main input
+    void setSendBus(const int bus, const int firstChannel, const int numChannels) {
+        sends.setRouting(bus, firstChannel, numChannels);
+    }
+
+    /// audio thread, bus 0 is the main input, the main input only gets delayed while there are sends
+    void setSendPreDelay(const int bus, const float ms) {
+        sends.setPreDelay(bus, ms);
+    }
+
+    /// audio thread, how a bus's left and right feed each line, see Input_Matrix::defaultInjection
+    void setSendInjection(const int bus, const data& left, const data& right) {
+        sends.setInjection(bus, left, right);
+    }
+
+    /// whether the last prepareToPlay found a send bus in use
+    bool hasSends() const {
+        return activeSends;
+    }
+
+    /// message thread, takes effect at the next prepareToPlay, for offline renders: the strings and
+    /// the diffuser run on the process's shared worker pool a sub block ahead of the feedback network,
+    /// the output is identical and no latency is added
+    void setPipelining(const bool shouldPipeline) {
+        pipelineRequested = shouldPipeline;
+    }
+
+    bool isPipelining() const {
+        return pipeline.isRunning();
     }
 
-    void processMidi(juce::MidiBuffer& midiMessages) {
+    /// consumes a whole buffer of events without rendering, e.g. while the wet path is bypassed
+    void processMidi(const juce::MidiBuffer& midiMessages) {
         for(const auto midiMessage : midiMessages) {
-            auto midiEvent = midiMessage.getMessage();
-            if(midiEvent.isNoteOn()) {
-                midiNotes.push_back(midiEvent.getNoteNumber());
-            }
-            else if(midiEvent.isNoteOff()) {
-                for(std::vector<int>::iterator it = midiNotes.begin(); it != midiNotes.end(); it++) {
-                    if(*it == midiEvent.getNoteNumber()) {
-                        midiNotes.erase(it);
-                    }
-                }
-            }
+            handleMidiEvent(midiMessage.getMessage());
         }
     }
 
-    void setSize(float newSize, float rt) {
-        rt = rt * 1000.f; // convert from seconds to milliseconds
-        if(!juce::approximatelyEqual(newSize, roomSizeMS)) {
-            roomSizeMS = newSize;
-            feedback.setTime(roomSizeMS);
-            diffusion.prepareToPlay(roomSizeMS, sampleRate);
+    void handleMidiEvent(const juce::MidiMessage& midiEvent) {
+        if(midiEvent.isNoteOn()) {
+            const int note = midiEvent.getNoteNumber();
+            heldNotes.push(note);
+            if(note < lowestPlayed.load(std::memory_order_relaxed)) lowestPlayed.store(note, std::memory_order_relaxed);
+            if(note < lowestNote) refusedNotes.fetch_add(1, std::memory_order_relaxed);
+        }
+        else if(midiEvent.isNoteOff()) {
+            heldNotes.remove(midiEvent.getNoteNumber());
         }
-        if(!juce::approximatelyEqual(rt, rt60MS)) {
-            rt60MS = rt;
-            float loop = roomSizeMS * 1.5f;
-            float loopPerRT60 = rt60MS / (loop);
-            float dbPerLoop = -60.f/loopPerRT60;
-            reverbDecay = powf(10.f,dbPerLoop * 0.05f);
-            feedback.setDecay(reverbDecay);
-            float cutoff = juce::jmap(rt, 200.f, 10000.f, 1000.f, 8000.f);
-            feedback.setFilterCutoff(cutoff);
+        else if(midiEvent.isAllNotesOff() || midiEvent.isAllSoundOff()) {
+            heldNotes.clear();
         }
+        else return;
+        updateFrequencies();
+    }
+
+    /// message thread, lets a static wet path switch to a rendered impulse response
+    void setFreeze(const bool shouldFreeze) {
+        frozen.setEnabled(shouldFreeze);
+    }
+
+    /// message thread, takes effect at the next prepareToPlay, the same seed always builds the same diffuser
+    void setTopologySeed(const uint32_t seed) {
+        topologySeed = seed;
+    }
+
+    void setStealPolicy(const Steal_Policy policy) {
+        voices.setPolicy(policy);
+    }
+
+    /// what a pruned stage does with its state, Clear keeps renders deterministic
+    void setPrunePolicy(const Prune_Policy policy) {
+        stringsGate.setPolicy(policy);
+        diffusionGate.setPolicy(policy);
+        feedbackGate.setPolicy(policy);
+    }
+
+    /// stages whose gain to the output is below this stop running
+    void setPruneThreshold(const float thresholdDB) {
+        const float threshold = juce::Decibels::decibelsToGain(thresholdDB);
+        stringsGate.setThreshold(threshold);
+        diffusionGate.setThreshold(threshold);
+        feedbackGate.setThreshold(threshold);
+    }
+
+    /// any thread, opt in, live playback only: steps down through the Quality_Tiers while the
+    /// blocks use more than threshold of their deadline and back up once there is headroom again
+    void setLoadGovernor(const bool shouldGovern, const float threshold = 0.7f) {
+        governor.setThreshold(threshold);
+        governor.setEnabled(shouldGovern);
+    }
+
+    bool isLoadGoverned() const {
+        return governor.isEnabled();
+    }
+
+    /// any thread, what the governor has the engine running at, e.g. polled by the GUI
+    Quality_Tier getQualityTier() const {
+        return governor.getTier();
+    }
+
+    /// any thread, the smoothed share of the deadline the last blocks used, while governed
+    double getProcessLoad() const {
+        return governor.getLoad();
+    }
+
+    /// message thread, the structural parts take effect at the next prepareToPlay
+    void setRenderProfile(const Render_Profile& profile) {
+        setMultirate(profile.multirate);
+        setCompact(profile.compact);
+        setPrunePolicy(profile.prunePolicy);
+        setPruneThreshold(profile.pruneThresholdDB);
+        setPipelining(profile.pipelining);
+        setUpdateBudget(profile.updateBudgetUS);
+    }
+
+    /// any thread, e.g. from AudioProcessor::setNonRealtime, pruning and the update budget switch
+    /// at the start of the next block, multirate, compact and pipelining still need a prepareToPlay
+    void switchRenderProfile(const Render_Profile& profile) {
+        pendingProfile.prunePolicy.store(static_cast<int>(profile.prunePolicy), std::memory_order_relaxed);
+        pendingProfile.pruneThresholdDB.store(profile.pruneThresholdDB, std::memory_order_relaxed);
+        pendingProfile.updateBudgetUS.store(profile.updateBudgetUS, std::memory_order_relaxed);
+        pendingProfile.waiting.store(true, std::memory_order_release);
+    }
+
+    /// message thread, takes effect at the next prepareToPlay, how long each block may spend retuning
+    /// the strings and rebuilding the diffuser after a change, 0 applies every change at once
+    void setUpdateBudget(const float microseconds) {
+        updateBudgetUS = microseconds;
+    }
+
+    /// audio thread, whether a change is still being spread over the coming blocks
+    bool hasPendingUpdates() const {
+        return !updates.isIdle();
+    }
+
+    /// message thread, takes effect at the next prepareToPlay
+    void setMultirate(const Multirate_Mode mode) {
+        multirateMode = mode;
+    }
+
+    /// 1, 2 or 4, the diffuser and feedback network run at the host rate divided by this
+    int getRateFactor() const {
+        return rateFactor;
+    }
+
+    /// message thread, takes effect at the next prepareToPlay, the string lines are sized for the
+    /// notes in use: every chord, and the lowest midi note played so far, a lower midi note is refused
+    /// (counted by getRefusedNotes) rather than played at another pitch, and the next prepare makes room for it
+    void setCompact(const bool shouldBeCompact) {
+        compactRequested = shouldBeCompact;
+    }
+
+    /// whether the last prepareToPlay ran compact, asked for or forced by the process limit
+    bool isCompact() const {
+        return lowestNote > Waveguide_String::LOWEST_NOTE;
+    }
+
+    /// the lowest midi note the strings have room for since the last prepareToPlay
+    int getLowestPlayableNote() const {
+        return lowestNote;
+    }
+
+    /// any thread, midi notes dropped because the compact strings had no room for them
+    int getRefusedNotes() const {
+        return refusedNotes.load(std::memory_order_relaxed);
+    }
+
+    void resetRefusedNotes() {
+        refusedNotes.store(0, std::memory_order_relaxed);
+    }
+
+    /// whether the last prepareToPlay went compact because the full size would have passed the process limit
+    bool isOverMemoryLimit() const {
+        return overMemoryLimit;
+    }
+
+    /// message thread while audio is stopped, otherwise a close estimate
+    Memory_Usage getMemoryUsage() const {
+        Memory_Usage usage;
+        usage.strings = sizeof(strings) + strings.getAllocatedBytes();
+        usage.diffusion = sizeof(diffusion) + diffusion.getAllocatedBytes()
+            + sizeof(highDiffusion) + highDiffusion[0].getAllocatedBytes() + highDiffusion[1].getAllocatedBytes();
+        usage.feedback = sizeof(feedback) + feedback.getAllocatedBytes();
+        usage.multirate = sizeof(crossover) + sizeof(lowBand) + sizeof(stringsDown);
+        usage.frozen = sizeof(frozen) + frozen.getAllocatedBytes();
+        const size_t components = sizeof(strings) + sizeof(diffusion) + sizeof(highDiffusion) + sizeof(feedback) + usage.multirate + sizeof(frozen);
+        usage.engine = sizeof(WaveVerb) - components + sends.getAllocatedBytes() + inputFrames.capacity() * sizeof(data);
+        return usage;
+    }
+
+    /// message thread while audio is stopped, e.g. from AudioProcessor::releaseResources, the delay lines
+    /// are parked in the pool every instance shares and the rest is freed, the next prepareToPlay takes
+    /// memory back (warm from the pool when it can), returns the bytes this instance gave up
+    size_t releaseResources() {
+        const size_t before = getMemoryUsage().total();
+        strings.release();
+        diffusion.release();
+        feedback.release();
+        highDiffusion[0].release();
+        highDiffusion[1].release();
+        frozen.release();
+        pipeline.stop();
+        std::vector<data>().swap(pipelineStrings);
+        std::vector<data>().swap(pipelineEarly);
+        std::vector<data>().swap(wetFrames);
+        decodedWet.setSize(0, 0);
+        sends.release();
+        activeSends = false;
+        std::vector<data>().swap(inputFrames);
+        prepared = {}; // the next prepare has to rebuild everything
+        residency = {};
+        const size_t after = getMemoryUsage().total();
+        reportMemory(after);
+        return before - after;
+    }
+
+    /// message thread, takes effect at the next prepareToPlay, reserves the lines for the largest room
+    /// and writes every page during prepare so the audio thread never faults or allocates on them,
+    /// shouldLock also mlocks them where RLIMIT_MEMLOCK allows
+    void setPrefault(const bool shouldPrefault, const bool shouldLock = false) {
+        prefaultRequested = shouldPrefault;
+        lockRequested = shouldPrefault && shouldLock;
+    }
+
+    /// any thread, counts the page faults taken inside processBuffer from now on (a getrusage call per block)
+    void setFaultMonitoring(const bool shouldMonitor) {
+        faults.setEnabled(shouldMonitor);
+    }
+
+    void resetFaultCounts() {
+        faults.resetCounts();
+    }
+
+    /// what the last prepare touched and locked, and the audio thread's faults while monitored
+    Residency_Report getResidencyReport() const {
+        Residency_Report report;
+        report.bytes = residency;
+        faults.fill(report);
+        report.peakResidentBytes = Page_Residency::peakResidentBytes();
+        return report;
+    }
+
+    /// any thread, the block rate nan/inf and subnormal scan is on by default
+    void setHealthMonitoring(const bool shouldCheck) {
+        health.setEnabled(shouldCheck);
+    }
+
+    Health_Report getHealthReport() const {
+        return health.getReport();
+    }
+
+    void resetHealthCounts() {
+        health.resetCounts();
+    }
+
+    /// released storage waiting in the shared pools
+    size_t getPooledMemory() const {
+        if constexpr (std::is_same_v<Line_Storage::Stored, Diffusion_Storage::Stored>) {
+            return linePool->getPooledBytes();
+        }
+        else {
+            return linePool->getPooledBytes() + diffusionPool->getPooledBytes();
+        }
+    }
+
+    /// shared by every instance, how much released storage is kept for reuse rather than freed
+    void setPoolLimit(const size_t bytes) {
+        linePool->setLimit(bytes);
+        diffusionPool->setLimit(bytes);
+    }
+
+    /// every instance in the process, as of their last prepareToPlay or releaseResources
+    size_t getProcessMemoryUsage() const {
+        return memory->getTotal();
+    }
+
+    /// shared by every instance, 0 for none, an instance that would go over prepares compact and says so
+    /// through isOverMemoryLimit
+    void setProcessMemoryLimit(const size_t bytes) {
+        memory->setLimit(bytes);
+    }
+
+    /// the diffuser is rebuilt a step at a time into spare lines when there is an update budget,
+    /// it goes in with the feedback lines' new length and decay once every step is done
+    void setSize(const float newSize, float rt) {
+        rt = rt * 1000.f; // convert from seconds to milliseconds
+        const bool resized = !juce::approximatelyEqual(newSize, roomSizeMS);
+        const bool retimed = !juce::approximatelyEqual(rt, rt60MS);
+        roomSizeMS = newSize;
+        rt60MS = rt;
+        if(resized) updates.schedule(roomJob);
+        else if(retimed && !updates.isPending(roomJob)) updateDecay();
     }
 
     void setDryWet(float dw) {
@@ -161,48 +586,25 @@ public:
         outputGain = juce::Decibels::decibelsToGain(gain);
     }
 
+    /// audio thread, or the message thread while audio is stopped
     void setModel(int type) {
         modelType = type;
     }
 
+    /// audio thread, or the message thread while audio is stopped, 0 to 11 from C,
+    /// picks the tuning prepareToPlay built and works the retune out over the update budget,
+    /// every voice switches on the same sample
     void setRoot(int root) {
-        root += 48;
         if(rootNote == root) return;
         rootNote = root;
-        updateFrequencies();
+        selectTuning();
     }
 
+    /// audio thread, or the message thread while audio is stopped, a ChordType
     void setChord(int chord) {
         if(chordType == chord) return;
         chordType = chord;
-        if(chordType == ChordType::Midi_Input) {
-            chordDegrees.clear();
-        }
-        else if(chord == ChordType::Single_Note) {
-            chordDegrees.resize(4);
-            chordDegrees = {0, 0, 0, 0};
-        }
-        else if(chord == ChordType::Major) {
-            chordDegrees.resize(4);
-            chordDegrees = {0, 4, 7, 12};
-        }
-        else if(chord == ChordType::Minor) {
-            chordDegrees.resize(4);
-            chordDegrees = {0, 3, 7, 12};
-        }
-        else if(chord == ChordType::Dominant) {
-            chordDegrees.resize(4);
-            chordDegrees = {0, 4, 7, 10};
-        }
-        else if(chord == ChordType::Major_Seven) {
-            chordDegrees.resize(4);
-            chordDegrees = {0, 4, 7, 11};
-        }
-        else if(chord == ChordType::Minor_Seven) {
-            chordDegrees.resize(4);
-            chordDegrees = {0, 3, 7, 10};
-        }
-        updateFrequencies();
+        selectTuning();
     }
 
     void setBlend(float b) {
@@ -214,7 +616,7 @@ public:
     void setWaveguideDecay(float d) {
         if(juce::approximatelyEqual(d, waveguideDecay)) return;
         waveguideDecay = d;
-        strings.setDecay(waveguideDecay);
+        reshapeVoices();
     }
 
     void setWaveguideRate(float r) {
@@ -224,15 +626,19 @@ public:
     }
 
     void setWaveguidePickup(float p) {
-        strings.setPickupPosition(p);
+        if(juce::approximatelyEqual(p, waveguidePickup)) return;
+        waveguidePickup = p;
+        reshapeVoices();
     }
 
     void setWaveguideTrigger(float t) {
-        strings.setTriggerPosition(t);
+        if(juce::approximatelyEqual(t, waveguideTrigger)) return;
+        waveguideTrigger = t;
+        reshapeVoices();
     }
 
     void reset() {
-        prepareToPlay(sampleRate);
+        prepareToPlay(sampleRate, prepared.maxBlockSize);
     }
 
 private:
@@ -251,51 +657,827 @@ private:
     float reverbDecay = 0.f;
 
     // waveguide parameters
-    int rootNote = 48;
+    int rootNote = 0; /// from C
     int chordType = 0;
     int modelType = 0;
-    std::vector<int> chordDegrees;
-    std::vector<int> midiNotes;
-    float waveguideDecay = 0.f;
+    const Tuning* currentTuning = nullptr; /// in tuningBank, null until the first prepare
+    Note_Stack heldNotes;
+    Voice_Allocator voices;
+    juce::SharedResourcePointer<Table_Registry<Tuning_Table>> tables;
+    std::shared_ptr<const Tuning_Table> tuningTable; /// shared with every instance at this rate
+    juce::SharedResourcePointer<Table_Registry<Tuning_Bank>> banks;
+    std::shared_ptr<const Tuning_Bank> tuningBank; /// shared with every instance at this rate
+    float waveguideDecay = 0.9f; /// the strings' own defaults until set
+    float waveguidePickup = 0.8f;
+    float waveguideTrigger = 0.2f;
     float waveguideRate = 0.f;
 
+    // where released delay lines wait, held here so the pools live as long as any instance
+    juce::SharedResourcePointer<Buffer_Pool<Line_Storage::Stored>> linePool;
+    juce::SharedResourcePointer<Buffer_Pool<Diffusion_Storage::Stored>> diffusionPool;
+
     Diffuser diffusion;
     Multi_Delay feedback;
     Mix_Matrix matrix;
     Multi_String strings;
 
-    void updateFrequencies() {
+    // band split late reverb, below the crossover runs at reverbRate
+    static constexpr float CROSSOVER_RATIO = 0.3f; /// of the reduced rate, inside the halfband passband
+    static constexpr float HIGH_BAND_MS = 20.f;
+    Multirate_Mode multirateMode = Multirate_Mode::Off;
+    int rateFactor = 1;
+    double reverbRate = 44100;
+    juce::dsp::LinkwitzRileyFilter<float> crossover;
+    Rate_Converter<2> lowBand;
+    Rate_Converter<NUM_CHANNELS> stringsDown;
+    Allpass_Chain highDiffusion[2];
+
+    // stage order
+    Graph_Layout graphLayout = Graph_Layout::Serial; /// message thread
+    Graph_Layout activeLayout = Graph_Layout::Serial;
+    int inputChannels = 2; /// message thread
+    int outputChannels = 2;
+    int activeInputs = 2;
+    int activeOutputs = 2;
+    IO_Layout activeIO = IO_Layout::Stereo;
+    Output_Decoder requestedDecoder; /// message thread
+    Output_Decoder decoder;
+    std::vector<data> wetFrames; /// one chunk of lines waiting to be decoded
+    juce::AudioBuffer<float> decodedWet;
+
+    // send buses
+    Input_Matrix sends;
+    bool activeSends = false;
+    std::vector<data> inputFrames; /// one chunk of every bus mixed onto the lines
+
+    // offline rendering
+    bool pipelineRequested = false; /// message thread
+    Stage_Pipeline pipeline;
+    std::vector<data> pipelineStrings; /// one chunk of each worker's output
+    std::vector<data> pipelineEarly;
+
+    // frozen impulse response
+    uint32_t topologySeed = 1;
+    Frozen_IR frozen;
+
+    /// everything prepareToPlay builds from, structural setters only take effect when this changes
+    struct Prepared_Config {
+        double sampleRate = 0;
+        int maxBlockSize = 0;
+        Multirate_Mode multirate = Multirate_Mode::Off;
+        int lowestNote = 0;
+        uint32_t seed = 0;
+        bool prefault = false;
+        bool lock = false;
+        Graph_Layout layout = Graph_Layout::Serial;
+        bool decoded = false;
+        bool sends = false;
+
+        bool operator==(const Prepared_Config& other) const {
+            return sampleRate == other.sampleRate && maxBlockSize == other.maxBlockSize && multirate == other.multirate
+                && lowestNote == other.lowestNote && seed == other.seed && prefault == other.prefault && lock == other.lock
+                && layout == other.layout && decoded == other.decoded && sends == other.sends;
+        }
+    };
+    Prepared_Config prepared;
+
+    // page residency
+    static constexpr float MAX_ROOM_SIZE_MS = 300.f; /// top of the room size parameter
+    bool prefaultRequested = false; /// message thread
+    bool lockRequested = false; /// message thread
+    Residency_Bytes residency;
+    Fault_Monitor faults;
+    Health_Monitor health;
+
+    // expensive changes spread over the following blocks
+    Update_Scheduler updates;
+    float updateBudgetUS = 0.f; /// message thread
+
+    // the parts of a render profile that switch without a prepare
+    struct Pending_Profile {
+        std::atomic<bool> waiting {false};
+        std::atomic<int> prunePolicy {0};
+        std::atomic<float> pruneThresholdDB {-80.f};
+        std::atomic<float> updateBudgetUS {0.f};
+    };
+    Pending_Profile pendingProfile;
+    int voiceJob = 0;
+    int roomJob = 0;
+    Tuning_Row stagedRows[Voice_Allocator::NUM_VOICES]; /// a zero frequency releases the voice
+    uint32_t pendingVoices = 0; /// new rows in stagedRows
+    uint32_t reshapedVoices = 0; /// the shape changed since they were worked out
+    Waveguide_String::Setup stagedSetups[Voice_Allocator::NUM_VOICES];
+    uint32_t stagedVoices = 0; /// worked out, waiting for commitVoices
+    uint32_t releasedVoices = 0; /// staged to ring out
+
+    // cpu governor
+    static constexpr int REDUCED_VOICES = Voice_Allocator::NUM_VOICES / 2;
+    Load_Governor governor;
+    Quality_Tier appliedTier = Quality_Tier::Full;
+
+    // memory accounting
+    bool compactRequested = false; /// message thread
+    bool overMemoryLimit = false;
+    int lowestNote = Waveguide_String::LOWEST_NOTE;
+    std::atomic<int> lowestPlayed {Tuning_Table::NUM_NOTES}; /// written by the audio thread, read by prepare
+    std::atomic<int> refusedNotes {0};
+    bool reportsMemory = true; /// the renderer's private engines stay out of the process total
+    size_t reportedBytes = 0;
+    juce::SharedResourcePointer<Memory_Tracker> memory;
+
+    const Kernel_Table* kernels = &Kernel_Dispatch::get(); /// output stage, picked for this cpu
+
+    // skip stages the mix coefficients make inaudible
+    Stage_Gate stringsGate;
+    Stage_Gate diffusionGate;
+    Stage_Gate feedbackGate;
+
+    /// audio thread, a held midi note keeps the strings until it's released
+    void selectTuning() {
+        if(tuningBank == nullptr) return; // prepareToPlay picks it
+        currentTuning = &tuningBank->get(rootNote, chordType);
+        if(heldNotes.isEmpty()) updateFrequencies(true);
+    }
+
+    /// audio thread, held midi notes win over the chord, only voices whose note changed are touched,
+    /// spread stages a voice at a time within the update budget and switches them together (chord changes),
+    /// midi notes land at once
+    void updateFrequencies(const bool spread = false) {
         if(!strings.isInitialised()) return;
-        std::vector<float> frequencies = getFrequencies();
-        if(frequencies.empty()) {
-            strings.resetAfterDecay();
+        const bool useChord = heldNotes.isEmpty() && currentTuning != nullptr;
+        const int* notes = useChord ? currentTuning->notes.data() : heldNotes.begin();
+        int numNotes = useChord ? currentTuning->numNotes : heldNotes.getSize();
+        // compact strings leave out the held notes they have no room for, chords always fit
+        int playable[Note_Stack::CAPACITY];
+        if(!useChord && lowestNote > Waveguide_String::LOWEST_NOTE) {
+            int kept = 0;
+            for(int i = 0; i < numNotes; i++) {
+                if(notes[i] >= lowestNote) playable[kept++] = notes[i];
+            }
+            notes = playable;
+            numNotes = kept;
+        }
+
+        const uint32_t changed = voices.allocate(notes, numNotes);
+        for(int v = 0; v < Voice_Allocator::NUM_VOICES; v++) {
+            if((changed & (1u << v)) == 0) continue;
+            const int note = voices.getNote(v);
+            // copied, the tuning it comes from may be swapped before the voice is retuned
+            stagedRows[v] = note == Voice_Allocator::NO_NOTE ? Tuning_Row() : rowFor(note, useChord);
+            pendingVoices |= 1u << v;
+        }
+        if(spread) {
+            updates.schedule(voiceJob);
+            return;
+        }
+        uint32_t staged = 0;
+        for(int v = 0; v < Voice_Allocator::NUM_VOICES; v++) {
+            if(stageVoice(v)) staged |= 1u << v;
+        }
+        commitVoices(staged);
+    }
+
+    /// audio thread, every voice is worked out again for the new shape
+    void reshapeVoices() {
+        reshapedVoices = (1u << Voice_Allocator::NUM_VOICES) - 1;
+        updates.schedule(voiceJob);
+    }
+
+    /// works a voice out from its staged row and the current shape, the string keeps playing
+    /// what it had until commitVoices, returns false if there was nothing to do
+    bool stageVoice(const int v) {
+        const uint32_t bit = 1u << v;
+        const bool retune = (pendingVoices & bit) != 0;
+        if(!retune && (reshapedVoices & bit) == 0) return false;
+        pendingVoices &= ~bit;
+        reshapedVoices &= ~bit;
+        const auto voice = static_cast<size_t>(v);
+        Tuning_Row row;
+        if(retune) {
+            // a released voice rings out on the note it is playing
+            const bool release = stagedRows[v].frequency <= 0.f;
+            if(release) releasedVoices |= bit;
+            else releasedVoices &= ~bit;
+            row = release ? strings.getTuning(voice) : stagedRows[v];
+        }
+        else if(stagedVoices & bit) {
+            row = stagedSetups[v].tuning;
+        }
+        else {
+            if(strings.hasShape(voice, waveguideDecay, waveguidePickup, waveguideTrigger)) return false;
+            row = strings.getTuning(voice);
+        }
+        stagedSetups[v] = strings.planVoice(voice, row, waveguideDecay, waveguidePickup, waveguideTrigger);
+        stagedVoices |= bit;
+        return true;
+    }
+
+    /// the staged voices among mask, all at once
+    void commitVoices(const uint32_t mask) {
+        for(int v = 0; v < Voice_Allocator::NUM_VOICES; v++) {
+            const uint32_t bit = 1u << v;
+            if((stagedVoices & mask & bit) == 0) continue;
+            strings.applyVoice(static_cast<size_t>(v), stagedSetups[v]);
+            if(releasedVoices & bit) strings.releaseVoice(static_cast<size_t>(v));
+        }
+        stagedVoices &= ~mask;
+        releasedVoices &= ~mask;
+    }
+
+    /// one powf and one set of filter coefficients every feedback line shares
+    void updateDecay() {
+        float loop = roomSizeMS * 1.5f;
+        float loopPerRT60 = rt60MS / (loop);
+        float dbPerLoop = -60.f/loopPerRT60;
+        reverbDecay = powf(10.f,dbPerLoop * 0.05f);
+        feedback.setDecay(reverbDecay);
+        float cutoff = juce::jmap(rt60MS, 200.f, 10000.f, 1000.f, 8000.f);
+        feedback.setFilterCutoff(cutoff);
+    }
+
+    /// what a repeated prepareToPlay does, every stage back to silence without touching the heap
+    void clearState() {
+        diffusion.reset();
+        feedback.reset();
+        highDiffusion[0].reset();
+        highDiffusion[1].reset();
+        crossover.reset();
+        lowBand.reset();
+        stringsDown.reset();
+        strings.clear();
+        strings.resetAfterDecay();
+        voices.reset();
+        updateFrequencies();
+        stringsGate.reset();
+        diffusionGate.reset();
+        feedbackGate.reset();
+        frozen.reset();
+        sends.reset();
+    }
+
+    /// rebuilds the strings for lowestNote and puts the current notes back on them
+    void prepareStrings(const double fs) {
+        strings.prepareToPlay(fs, lowestNote);
+        for(size_t v = 0; v < Voice_Allocator::NUM_VOICES; v++) {
+            strings.setShape(v, waveguideDecay, waveguidePickup, waveguideTrigger);
+        }
+        strings.resetAfterDecay();
+        voices.reset();
+        pendingVoices = 0;
+        reshapedVoices = 0;
+        stagedVoices = 0;
+        releasedVoices = 0;
+        updateFrequencies();
+    }
+
+    /// block rate, scans what the feedback lines and strings wrote this block, clearing the lines
+    /// that went non finite on their own so one bad sample can't circulate forever
+    void checkHealth(const int numSamples) {
+        if(!health.isEnabled() || !feedbackGate.isRunning()) return;
+        int cleared = 0;
+        // the late lines take one sample per reduced rate frame, one more covers the phase
+        uint32_t flags = feedback.checkHealth(numSamples / rateFactor + 1, cleared);
+        if(stringsGate.isRunning()) flags |= strings.checkHealth(numSamples, cleared);
+        if(flags & Non_Finite) {
+            // whatever fed the bad value in may still hold it, the filters would keep it forever
+            diffusion.reset();
+            highDiffusion[0].reset();
+            highDiffusion[1].reset();
+            crossover.reset();
+            lowBand.reset();
+            stringsDown.reset();
+        }
+        health.record(flags, cleared);
+    }
+
+    /// maps in every line the audio thread will touch, the lines that may grow are already reserved
+    void prefault() {
+        const bool wasLocked = residency.locked > 0;
+        residency = {};
+        if(!prefaultRequested && !wasLocked) return;
+        residency += strings.prefault(lockRequested);
+        residency += diffusion.prefault(lockRequested);
+        residency += feedback.prefault(lockRequested);
+        residency += highDiffusion[0].prefault(lockRequested); // empty unless multirate ever ran
+        residency += highDiffusion[1].prefault(lockRequested);
+        if(!prefaultRequested) residency = {}; // only went through to unlock
+    }
+
+    /// chords never go below the root parameter's C, midi notes as low as any that was played
+    int getCompactLowestNote() const {
+        return juce::jmax(Waveguide_String::LOWEST_NOTE, juce::jmin(Tuning_Bank::LOWEST_ROOT, lowestPlayed.load(std::memory_order_relaxed)));
+    }
+
+    /// reports this instance to the process total, going compact first if the full size would pass the limit
+    void updateMemoryReport() {
+        size_t bytes = getMemoryUsage().total();
+        overMemoryLimit = false;
+        const int compactLowest = getCompactLowestNote();
+        if(reportsMemory && lowestNote < compactLowest && !memory->fits(reportedBytes, bytes)) {
+            overMemoryLimit = true;
+            lowestNote = compactLowest;
+            prepareStrings(sampleRate);
+            bytes = getMemoryUsage().total();
         }
-        else strings.setFrequencies(frequencies);
+        reportMemory(bytes);
+    }
+
+    void reportMemory(const size_t bytes) {
+        if(!reportsMemory) return;
+        memory->update(reportedBytes, bytes);
+        reportedBytes = bytes;
     }
 
-    std::vector<float> getFrequencies() {
-        std::vector<float> frequencies;
-        if(!midiNotes.empty()) {
-            for(const int midiNote : midiNotes) {
-                float freq = midiToFreq(midiNote);
-                frequencies.push_back(freq);
+    /// numInputs and numOutputs are only read on the multichannel path, the others know theirs
+    template<typename Path>
+    void processChunk(juce::AudioBuffer<float>& buffer, const int startSample, const int numSamples, const int numInputs, const int numOutputs) {
+        // the inputs the wet path and the convolution see, a mono input has no right side
+        const float* inL = buffer.getReadPointer(0, startSample);
+        const float* inR = nullptr;
+        float foldL[Frozen_IR::BLOCK_SIZE];
+        float foldR[Frozen_IR::BLOCK_SIZE];
+        if constexpr(Path::INPUTS == 2) {
+            inR = buffer.getReadPointer(1, startSample);
+        }
+        else if constexpr(Path::INPUTS == 0) {
+            if(Path::DECODED && numInputs == decoder.getNumOutputs()) decoder.foldInputs(buffer, startSample, numSamples, foldL, foldR);
+            else foldInputs(buffer, startSample, numSamples, numInputs, foldL, foldR);
+            inL = foldL;
+            inR = foldR;
+        }
+        if constexpr(Path::SEND_BUSES) {
+            sends.process(buffer, startSample, numSamples, inL, inR, inputFrames.data());
+        }
+        const float* const* convolved = frozen.process(inL, inR, numSamples);
+        const bool liveRunning = frozen.isLiveRunning();
+        const bool feedingLive = frozen.isFeedingLive();
+        if constexpr(Path::SEND_BUSES) {
+            if(!feedingLive) std::fill_n(inputFrames.begin(), numSamples, data());
+        }
+
+        float wetL[Frozen_IR::BLOCK_SIZE] = {0.f};
+        float wetR[Frozen_IR::BLOCK_SIZE] = {0.f};
+        if(liveRunning) {
+            // once frozen the network only rings out what it already had
+            visitGraph(activeLayout, [&](auto graph) {
+                using Graph = decltype(graph);
+                if constexpr(Pipeline_Split<Graph>::PIPELINED) {
+                    if(pipeline.isRunning() && rateFactor == 1) {
+                        renderPipelined<Graph, Path>(feedingLive ? inL : nullptr, feedingLive ? inR : nullptr, wetL, wetR, numSamples);
+                        return;
+                    }
+                }
+                for(int i = 0; i < numSamples; i++) {
+                    const float sampleL = feedingLive ? inL[i] : 0.f;
+                    const float sampleR = Path::MONO_IN || !feedingLive ? 0.f : inR[i];
+                    if constexpr(Path::DECODED) {
+                        wetFrames[static_cast<size_t>(i)] = feedbackGate.isRunning() ? processWetFrame<Graph, Path>(sampleL, sampleR, i) : data();
+                    }
+                    else {
+                        processWetSample<Graph, Path>(sampleL, sampleR, wetL[i], wetR[i], i);
+                    }
+                }
+            });
+        }
+        else if constexpr(Path::DECODED) {
+            std::fill_n(wetFrames.begin(), numSamples, data());
+        }
+        if(convolved != nullptr) {
+            for(int i = 0; i < numSamples; i++) {
+                wetL[i] += convolved[0][i];
+            }
+            if constexpr(!Path::MONO_OUT) {
+                for(int i = 0; i < numSamples; i++) {
+                    wetR[i] += convolved[1][i];
+                }
+            }
+        }
+
+        if constexpr(Path::INPUTS == 0) {
+            // folded, even outputs are the left side and odd the right, each output is mixed with the input of the same number
+            float* const* decodedChannels = nullptr;
+            if constexpr(Path::DECODED) {
+                static_assert(sizeof(data) == sizeof(float) * NUM_CHANNELS, "the decode kernel steps through the frames as one array");
+                jassert(convolved == nullptr);
+                decodedChannels = decodedWet.getArrayOfWritePointers();
+                kernels->decode(wetFrames.front().channels, decoder.getMatrix(), decodedChannels, numOutputs, numSamples);
+            }
+            float silence[Frozen_IR::BLOCK_SIZE];
+            if(numOutputs > numInputs) std::fill(silence, silence + numSamples, 0.f);
+            for(int channel = 0; channel < numOutputs; channel++) {
+                const float* wet = Path::DECODED ? decodedChannels[channel] : (channel % 2 == 0 ? wetL : wetR);
+                const float* dry = channel < numInputs ? buffer.getReadPointer(channel, startSample) : silence;
+                kernels->outputStage(wet, dry, buffer.getWritePointer(channel, startSample), numSamples, outputGain, outCoeff, inCoeff);
             }
         }
         else {
-            for(const int chordDegree : chordDegrees) {
-                float freq = midiToFreq(rootNote + chordDegree);
-                frequencies.push_back(freq);
+            const float* dryL = buffer.getReadPointer(0, startSample);
+            if constexpr(Path::OUTPUTS == 2) {
+                // before the left side, a mono input is still needed as the dry signal on both
+                const float* dryR = Path::MONO_IN ? dryL : buffer.getReadPointer(1, startSample);
+                kernels->outputStage(wetR, dryR, buffer.getWritePointer(1, startSample), numSamples, outputGain, outCoeff, inCoeff);
+            }
+            kernels->outputStage(wetL, dryL, buffer.getWritePointer(0, startSample), numSamples, outputGain, outCoeff, inCoeff);
+        }
+    }
+
+    /// averages the even inputs into the left side and the odd ones into the right,
+    /// a single input goes in as left and inverted right like on the mono paths
+    static void foldInputs(const juce::AudioBuffer<float>& buffer, const int startSample, const int numSamples, const int numInputs, float* left, float* right) {
+        std::fill(left, left + numSamples, 0.f);
+        std::fill(right, right + numSamples, 0.f);
+        if(numInputs == 1) {
+            const float* in = buffer.getReadPointer(0, startSample);
+            for(int i = 0; i < numSamples; i++) {
+                left[i] = in[i];
+                right[i] = -in[i];
             }
+            return;
+        }
+        for(int channel = 0; channel < numInputs; channel++) {
+            const float* in = buffer.getReadPointer(channel, startSample);
+            float* side = channel % 2 == 0 ? left : right;
+            for(int i = 0; i < numSamples; i++) {
+                side[i] += in[i];
+            }
+        }
+        const float leftGain = 1.f / static_cast<float>(juce::jmax(1, (numInputs + 1) / 2));
+        const float rightGain = 1.f / static_cast<float>(juce::jmax(1, numInputs / 2));
+        for(int i = 0; i < numSamples; i++) {
+            left[i] *= leftGain;
+            right[i] *= rightGain;
         }
-        return frequencies;
     }
 
-    static float midiToFreq(const int midi) {
-        return std::powf(2, (static_cast<float>(midi) - 69.f) / 12.f) * 440.f;
+    void prepareMultirate(const double fs) {
+        // strings tuned at the host rate can't sit behind a stage running slower
+        // the rate converters only carry the stereo fold down of the main input
+        const bool foldedOutput = activeIO != IO_Layout::Decoded && !activeSends;
+        const Multirate_Mode mode = hasHostRateStrings(activeLayout) && foldedOutput ? multirateMode : Multirate_Mode::Off;
+        rateFactor = 1;
+        if(mode == Multirate_Mode::Half) rateFactor = 2;
+        else if(mode == Multirate_Mode::Quarter) rateFactor = 4;
+        else if(mode == Multirate_Mode::Auto) rateFactor = fs >= 176400.0 ? 4 : (fs >= 88200.0 ? 2 : 1);
+        reverbRate = fs / rateFactor;
+        lowBand.prepare(rateFactor);
+        stringsDown.prepare(rateFactor);
+        if(rateFactor == 1) return;
+
+        juce::dsp::ProcessSpec spec(fs, 512, 2);
+        crossover.prepare(spec);
+        crossover.setCutoffFrequency(static_cast<float>(reverbRate) * CROSSOVER_RATIO);
+        crossover.reset();
+        highDiffusion[0].prepareToPlay(fs, HIGH_BAND_MS, 1.f, 0.6f);
+        highDiffusion[1].prepareToPlay(fs, HIGH_BAND_MS, 0.87f, 0.6f);
     }
 
-    static float softClip(const float input) {
-        return (2.f / juce::MathConstants<float>::pi) * atanf(input);
+    data processStrings(const data& input) {
+        data mout;
+        if(stringsGate.isRunning()) {
+            mout = strings.process(input);
+            if(stringsGate.isFading()) mout.scale(stringsGate.getNextGain());
+        }
+        return mout;
+    }
+
+    /// sampleR is ignored on a mono input path, outR isn't written on a mono output path,
+    /// with sends the input is sample i of the chunk's inputFrames instead
+    template<typename Graph, typename Path = Stereo_Path>
+    void processWetSample(const float sampleL, const float sampleR, float& outL, float& outR, const int i = 0) {
+        outL = 0.f;
+        outR = 0.f;
+        // the upstream gates never outlive the feedback gate, their contribution includes the wet level
+        if(!feedbackGate.isRunning()) return;
+        if(rateFactor == 1) {
+            const data lines = processWetFrame<Graph, Path>(sampleL, sampleR, i);
+            if constexpr(Path::MONO_OUT) {
+                outL = matrix.multiToMono(lines);
+            }
+            else {
+                matrix.multiToStereo(lines, outL, outR);
+            }
+        }
+        else {
+            // the crossover and the rate converters are stereo, prepareMultirate keeps sends at the host rate
+            jassert(!Path::SEND_BUSES);
+            processMultirate<Graph>(sampleL, Path::MONO_IN ? -sampleL : sampleR, outL, outR);
+        }
+    }
+
+    /// the network's lines for one input frame at the host rate, the feedback gate has to be running
+    template<typename Graph, typename Path>
+    data processWetFrame(const float sampleL, const float sampleR, const int i) {
+        Stage_Frame frame;
+        frame[Stage_Slot::Input] = injectInput<Path>(sampleL, sampleR, i);
+        Graph::process(*this, frame);
+        return frame[Stage_Slot::Out];
+    }
+
+    struct Pipeline_Task {
+        WaveVerb* verb = nullptr;
+        const float* inL = nullptr; /// nullptr while frozen
+        const float* inR = nullptr;
+        float* wetL = nullptr;
+        float* wetR = nullptr;
+
+        template<typename Path>
+        data input(const int i) const {
+            if constexpr(Path::SEND_BUSES) {
+                return verb->inputFrames[static_cast<size_t>(i)]; // already silent while frozen
+            }
+            else if constexpr(Path::MONO_IN) {
+                return verb->matrix.monoToMulti(inL != nullptr ? inL[i] : 0.f);
+            }
+            else {
+                return verb->matrix.stereoToMulti(inL != nullptr ? inL[i] : 0.f, inR != nullptr ? inR[i] : 0.f);
+            }
+        }
+    };
+
+    /// the main input's pattern on the lines, or sample i of the chunk Input_Matrix mixed with sends
+    template<typename Path>
+    data injectInput(const float sampleL, const float sampleR, const int i) {
+        if constexpr(Path::SEND_BUSES) {
+            return inputFrames[static_cast<size_t>(i)];
+        }
+        else if constexpr(Path::MONO_IN) {
+            return matrix.monoToMulti(sampleL);
+        }
+        else {
+            return matrix.stereoToMulti(sampleL, sampleR);
+        }
+    }
+
+    void prepareSends(const double fs) {
+        sends.prepare(fs);
+        activeSends = sends.hasSends();
+        if(!activeSends) {
+            std::vector<data>().swap(inputFrames);
+            return;
+        }
+        inputFrames.resize(Frozen_IR::BLOCK_SIZE);
+    }
+
+    void prepareDecoder() {
+        if(activeIO != IO_Layout::Decoded) {
+            std::vector<data>().swap(wetFrames);
+            decodedWet.setSize(0, 0);
+            return;
+        }
+        wetFrames.resize(Frozen_IR::BLOCK_SIZE);
+        decodedWet.setSize(Output_Decoder::MAX_OUTPUTS, Frozen_IR::BLOCK_SIZE, false, false, true);
+    }
+
+    void preparePipeline() {
+        if(!pipelineRequested) {
+            pipeline.stop();
+            return;
+        }
+        pipeline.start();
+        pipelineStrings.resize(Frozen_IR::BLOCK_SIZE);
+        pipelineEarly.resize(Frozen_IR::BLOCK_SIZE);
+    }
+
+    /// the same as processWetSample<Graph> over the chunk, with the strings and the diffuser on the workers,
+    /// each stage only touches its own state so running them side by side changes nothing
+    template<typename Graph, typename Path>
+    void renderPipelined(const float* inL, const float* inR, float* wetL, float* wetR, const int numSamples) {
+        if(!feedbackGate.isRunning()) {
+            if constexpr(Path::DECODED) std::fill_n(wetFrames.begin(), numSamples, data());
+            return;
+        }
+        Pipeline_Task task {this, inL, inR, wetL, wetR};
+        pipeline.run(numSamples,
+            [](void* context, const int start, const int end) {
+                const auto& t = *static_cast<Pipeline_Task*>(context);
+                for(int i = start; i < end; i++) {
+                    t.verb->pipelineStrings[static_cast<size_t>(i)] = t.verb->processStrings(t.input<Path>(i));
+                }
+            },
+            [](void* context, const int start, const int end) {
+                const auto& t = *static_cast<Pipeline_Task*>(context);
+                Stage_Frame frame;
+                for(int i = start; i < end; i++) {
+                    frame[Stage_Slot::Input] = t.input<Path>(i);
+                    t.verb->runStage(Diffusion_Stage<Stage_Slot::Input, Stage_Slot::Early> {}, frame);
+                    t.verb->pipelineEarly[static_cast<size_t>(i)] = frame[Stage_Slot::Early];
+                }
+            },
+            [](void* context, const int start, const int end) {
+                const auto& t = *static_cast<Pipeline_Task*>(context);
+                Stage_Frame frame;
+                for(int i = start; i < end; i++) {
+                    frame[Stage_Slot::Input] = t.input<Path>(i);
+                    frame[Stage_Slot::Strings] = t.verb->pipelineStrings[static_cast<size_t>(i)];
+                    frame[Pipeline_Split<Graph>::DIFFUSION_SLOT] = t.verb->pipelineEarly[static_cast<size_t>(i)];
+                    Pipeline_Split<Graph>::Late::process(*t.verb, frame);
+                    if constexpr(Path::DECODED) {
+                        t.verb->wetFrames[static_cast<size_t>(i)] = frame[Stage_Slot::Out];
+                    }
+                    else if constexpr(Path::MONO_OUT) {
+                        t.wetL[i] = t.verb->matrix.multiToMono(frame[Stage_Slot::Out]);
+                    }
+                    else {
+                        t.verb->matrix.multiToStereo(frame[Stage_Slot::Out], t.wetL[i], t.wetR[i]);
+                    }
+                }
+            },
+            &task);
+    }
+
+    // the stages a graph is built from, the diffuser and feedback network run at reverbRate
+    template<typename... Stages> friend struct Stage_Graph;
+
+    template<Stage_Slot From>
+    void runStage(Strings_Stage<From>, Stage_Frame& frame) {
+        frame[Stage_Slot::Strings] = processStrings(frame[From]);
+    }
+
+    template<Stage_Slot From, Stage_Slot To>
+    void runStage(Diffusion_Stage<From, To>, Stage_Frame& frame) {
+        data dout;
+        if(diffusionGate.isRunning()) {
+            dout = diffusion.process(frame[From]);
+            if(diffusionGate.isFading()) dout.scale(diffusionGate.getNextGain());
+        }
+        frame[To] = dout;
+    }
+
+    template<Stage_Slot From, Stage_Slot To>
+    void runStage(Blend_Stage<From, To>, Stage_Frame& frame) {
+        if(modelType != ModelType::None) {
+            frame[To] = matrix.intermix(frame[From], frame[Stage_Slot::Strings], blendInCoeff, blendOutCoeff);
+        }
+        else if(From != To) {
+            frame[To] = frame[From];
+        }
+    }
+
+    template<Stage_Slot From, Stage_Slot To>
+    void runStage(Feedback_Stage<From, To>, Stage_Frame& frame) {
+        frame[To] = feedback.process(frame[From]);
+        if(feedbackGate.isFading()) frame[To].scale(feedbackGate.getNextGain());
+    }
+
+    template<Stage_Slot A, Stage_Slot B, Stage_Slot To>
+    void runStage(Sum_Stage<A, B, To>, Stage_Frame& frame) {
+        frame[To] = frame[A] + frame[B];
+    }
+
+    /// the band below the crossover goes through the late reverb at reverbRate,
+    /// the band above only through a short allpass chain per side at the host rate
+    template<typename Graph>
+    void processMultirate(const float sampleL, const float sampleR, float& outL, float& outR) {
+        float low[2] = {0.f};
+        float high[2] = {0.f};
+        crossover.processSample(0, sampleL, low[0], high[0]);
+        crossover.processSample(1, sampleR, low[1], high[1]);
+
+        // the strings stay at the host rate so their tuning is exact
+        const bool stringsRunning = stringsGate.isRunning();
+        data mout;
+        if(stringsRunning) mout = processStrings(matrix.stereoToMulti(sampleL, sampleR));
+
+        float lowFrame[2] = {0.f};
+        data lowStrings;
+        const bool ready = lowBand.down(low, lowFrame);
+        stringsDown.down(stringsRunning ? mout.channels : nullptr, lowStrings.channels);
+        if(ready) {
+            Stage_Frame frame;
+            frame[Stage_Slot::Input] = matrix.stereoToMulti(lowFrame[0], lowFrame[1]);
+            frame[Stage_Slot::Strings] = lowStrings;
+            Graph_Split<Graph>::Late::process(*this, frame);
+            float wet[2] = {0.f};
+            matrix.multiToStereo(frame[Stage_Slot::Out], wet[0], wet[1]);
+            lowBand.up(wet);
+        }
+        const float* wet = lowBand.next();
+        outL = wet[0];
+        outR = wet[1];
+
+        if(diffusionGate.isRunning()) {
+            const float highL = highDiffusion[0].process(high[0]);
+            const float highR = highDiffusion[1].process(high[1]);
+            const float gain = (modelType == ModelType::None ? 1.f : blendInCoeff) * diffusionGate.getGain();
+            outL += highL * gain;
+            outR += highR * gain;
+        }
+    }
+
+    void beginBlock(const int numSamples) {
+        applyPendingProfile();
+        updates.run();
+        applyQualityTier(governor.getTier());
+        updateStageGates();
+        // a decoded output or send buses can't be replaced by the stereo response of the main input,
+        // they always count as non linear
+        frozen.update(getSnapshot(), !stringsGate.isRunning() && activeIO != IO_Layout::Decoded && !activeSends, numSamples);
+    }
+
+    Engine_Snapshot getSnapshot() const {
+        Engine_Snapshot snapshot;
+        snapshot.sampleRate = sampleRate;
+        snapshot.roomSizeMS = roomSizeMS;
+        snapshot.rt60MS = rt60MS;
+        snapshot.blend = blend;
+        snapshot.modelType = modelType;
+        snapshot.multirate = static_cast<int>(multirateMode);
+        snapshot.layout = static_cast<int>(activeLayout);
+        snapshot.seed = topologySeed;
+        return snapshot;
+    }
+
+    /// renderer thread, the wet response to an impulse on each input, long enough to fall about 90 dB
+    static void renderImpulseResponse(const Engine_Snapshot& snapshot, juce::AudioBuffer<float>& fromLeft, juce::AudioBuffer<float>& fromRight) {
+        const double seconds = juce::jmin(Frozen_IR::MAX_IR_SECONDS, (1.5 * snapshot.rt60MS + 3.0 * snapshot.roomSizeMS) * 0.001);
+        const int length = juce::roundToInt(seconds * snapshot.sampleRate);
+        fromLeft.setSize(2, length);
+        fromRight.setSize(2, length);
+        renderImpulse(snapshot, fromLeft, 0);
+        renderImpulse(snapshot, fromRight, 1);
+    }
+
+    static void renderImpulse(const Engine_Snapshot& snapshot, juce::AudioBuffer<float>& response, const int channel) {
+        WaveVerb engine;
+        engine.reportsMemory = false;
+        engine.topologySeed = snapshot.seed;
+        engine.multirateMode = static_cast<Multirate_Mode>(snapshot.multirate);
+        engine.graphLayout = static_cast<Graph_Layout>(snapshot.layout);
+        engine.roomSizeMS = snapshot.roomSizeMS;
+        engine.rt60MS = snapshot.rt60MS;
+        // the strings are silent whenever a response is frozen, any other model mixes the same way
+        engine.modelType = snapshot.modelType == ModelType::String ? ModelType::Closed_Tube : snapshot.modelType;
+        engine.prepareToPlay(snapshot.sampleRate);
+        engine.setBlend(snapshot.blend * 100.f);
+        engine.setDryWet(100.f);
+        engine.updateStageGates();
+
+        const int length = response.getNumSamples();
+        const int fadeLength = juce::jmin(length, juce::roundToInt(0.01 * snapshot.sampleRate));
+        for(int i = 0; i < length; i++) {
+            const float impulse = i == 0 ? 1.f : 0.f;
+            float outL = 0.f;
+            float outR = 0.f;
+            engine.processWetSample(channel == 0 ? impulse : 0.f, channel == 1 ? impulse : 0.f, outL, outR);
+            // short fade so the truncated tail doesn't click
+            const int remaining = length - i;
+            const float fade = remaining < fadeLength ? static_cast<float>(remaining) / static_cast<float>(fadeLength) : 1.f;
+            response.setSample(0, i, outL * fade);
+            response.setSample(1, i, outR * fade);
+        }
+    }
+
+    /// block rate, every change crossfades or rings out inside the stage it touches
+    /// audio thread, a switch that lands while this runs leaves the flag set and is applied again next block
+    void applyPendingProfile() {
+        if(!pendingProfile.waiting.exchange(false, std::memory_order_acquire)) return;
+        setPrunePolicy(static_cast<Prune_Policy>(pendingProfile.prunePolicy.load(std::memory_order_relaxed)));
+        setPruneThreshold(pendingProfile.pruneThresholdDB.load(std::memory_order_relaxed));
+        updates.setBudget(pendingProfile.updateBudgetUS.load(std::memory_order_relaxed));
+        // unbudgeted changes apply at once, anything still spread out catches up now
+        if(!updates.isBudgeted()) updates.finishAll();
+    }
+
+    void applyQualityTier(const Quality_Tier tier) {
+        if(tier == appliedTier) return;
+        appliedTier = tier;
+        diffusion.setShortened(tier >= Quality_Tier::Short_Diffusion);
+        const int voiceLimit = tier >= Quality_Tier::Fewer_Strings ? REDUCED_VOICES : Voice_Allocator::NUM_VOICES;
+        if(voiceLimit != voices.getVoiceLimit()) {
+            voices.setVoiceLimit(voiceLimit);
+            strings.setActiveVoices(static_cast<size_t>(voiceLimit));
+            updateFrequencies();
+        }
+        feedback.setControlRateModulation(tier >= Quality_Tier::Control_Rate_Modulation);
+    }
+
+    /// block rate, works out each stage's gain to the output from the current mix coefficients
+    void updateStageGates() {
+        const float wet = outCoeff * outputGain;
+        const float stringsGain = modelType == ModelType::String ? blendOutCoeff * wet : 0.f;
+        const float diffusionGain = modelType == ModelType::None ? wet : blendInCoeff * wet;
+        if(feedbackGate.update(wet)) {
+            feedback.reset();
+            crossover.reset();
+            lowBand.reset();
+            stringsDown.reset();
+        }
+        if(diffusionGate.update(diffusionGain)) {
+            diffusion.reset();
+            highDiffusion[0].reset();
+            highDiffusion[1].reset();
+        }
+        if(stringsGate.update(stringsGain)) strings.clear();
+    }
+
+    /// chord notes come with their rows prebuilt, anything else is looked up
+    const Tuning_Row& rowFor(const int note, const bool useChord) const {
+        if(useChord) {
+            for(int k = 0; k < currentTuning->numNotes; k++) {
+                if(currentTuning->notes[static_cast<size_t>(k)] == note) return currentTuning->rows[static_cast<size_t>(k)];
+            }
+        }
+        return (*tuningTable)[note];
     }
 };
 
@@ -1,10 +1,15 @@
 #ifndef COLIN_DELAY_H
 #define COLIN_DELAY_H
 #include <math.h>
+#include <algorithm>
 #include <vector>
+#include <cstdint>
 #include <cstdlib>
 #include "Mix_Matrix.h"
 #include "../Utility/LFO.h"
+#include "../Utility/Buffer_Pool.h"
+#include "../Utility/Page_Residency.h"
+#include "../Utility/Sample_Storage.h"
 #include "juce_dsp/juce_dsp.h"
 
 /*
@@ -22,35 +27,52 @@
 namespace Colin
 {
 
-class Circular_Buffer {
+/// Storage converts samples on the way in and out, see Sample_Storage.h
+template<typename Storage>
+class Basic_Circular_Buffer {
 protected:
-    int size;
+    using Stored = typename Storage::Stored;
+    int size = 0;
     int position = 0;
-    std::vector<float> buffer;
+    std::vector<Stored> buffer;
+    bool locked = false; /// the storage is mlocked, has to be unlocked before it moves
     
 public:
-    Circular_Buffer() = default;
-    Circular_Buffer(int size) {
+    Basic_Circular_Buffer() = default;
+    Basic_Circular_Buffer(int size) {
         this->size = size;
-        buffer.resize(size, 0);
+        buffer.resize(size, Stored());
+    }
+
+    Basic_Circular_Buffer(const Basic_Circular_Buffer& other)
+        : size(other.size), position(other.position), buffer(other.buffer) {}
+
+    Basic_Circular_Buffer& operator=(const Basic_Circular_Buffer& other) {
+        unlock();
+        size = other.size;
+        position = other.position;
+        buffer = other.buffer;
+        return *this;
     }
     
-    ~Circular_Buffer() = default;
+    ~Basic_Circular_Buffer() {
+        unlock();
+    }
     
     void add(const float value) {
         jassert(position < size);
-        buffer[position] = value;
+        buffer[position] = Storage::encode(value);
         position++;
         if (position == size) position = 0;
     }
 
     void setAt(int pos, float value) {
-        buffer[pos] = value;
+        buffer[pos] = Storage::encode(value);
     }
     
     float getBack() const {
         //if(position < 0 || position >= size) return 0;
-        return buffer[position];
+        return Storage::decode(buffer[position]);
     }
 
     float getNext(float fractional) {
@@ -58,7 +80,7 @@ public:
     }
 
     float getOffset(int offset) {
-        return buffer[validPos(position + offset)];
+        return Storage::decode(buffer[validPos(position + offset)]);
     }
 
     float getAt(float pos) {
@@ -67,8 +89,34 @@ public:
         return cubicInter(roundPos, fractional);
     }
     
+    /// allocates up front so later resizes up to capacity never touch the heap,
+    /// a smaller capacity than before gives the rest back
+    void reserve(const int capacity) {
+        const size_t wanted = static_cast<size_t>(capacity);
+        if(buffer.capacity() == 0 && wanted > 0) {
+            buffer = juce::SharedResourcePointer<Buffer_Pool<Stored>>()->acquire(wanted);
+            return;
+        }
+        if(wanted != buffer.capacity()) unlock(); // about to move
+        if(wanted < buffer.capacity()) {
+            std::vector<Stored> smaller;
+            smaller.reserve(wanted);
+            smaller.assign(buffer.begin(), buffer.begin() + static_cast<std::ptrdiff_t>(std::min(buffer.size(), wanted)));
+            buffer.swap(smaller);
+            size = static_cast<int>(buffer.size());
+            if(position >= size) position = 0;
+            return;
+        }
+        buffer.reserve(wanted);
+    }
+
     void resize(const int newSize) {
-        buffer.resize(newSize, 0);
+        if(buffer.capacity() == 0 && newSize > 0) {
+            // released, take storage back from the pool
+            buffer = juce::SharedResourcePointer<Buffer_Pool<Stored>>()->acquire(static_cast<size_t>(newSize));
+        }
+        if(static_cast<size_t>(newSize) > buffer.capacity()) unlock(); // about to move
+        buffer.resize(newSize, Stored());
         size = newSize;
         if(position >= newSize) {
             position = 0;
@@ -77,9 +125,18 @@ public:
     }
     
     void reset() {
-        std::fill(buffer.begin(), buffer.end(), 0.f);
+        std::fill(buffer.begin(), buffer.end(), Stored());
         //position = 0;
     }
+
+    /// never on the audio thread, parks the storage in the shared pool, the next resize or reserve takes some back
+    void release() {
+        unlock();
+        juce::SharedResourcePointer<Buffer_Pool<Stored>>()->release(std::move(buffer));
+        buffer = std::vector<Stored>();
+        size = 0;
+        position = 0;
+    }
     
     int validPos(const int pos) const {
         if(pos < 0) return size + pos;
@@ -88,10 +145,10 @@ public:
     }
     
     float cubicInter(const int pos, const float fractional) {
-        float a = buffer[validPos(pos-2)];
-        float b = buffer[validPos(pos-1)];
-        float c = buffer[validPos(pos)];
-        float d = buffer[validPos(pos+1)];
+        float a = Storage::decode(buffer[validPos(pos-2)]);
+        float b = Storage::decode(buffer[validPos(pos-1)]);
+        float c = Storage::decode(buffer[validPos(pos)]);
+        float d = Storage::decode(buffer[validPos(pos+1)]);
         float cbDiff = c-b;
         float k1 = (c-a) * 0.5;
         float k3 = k1 + (d-b) * 0.5 - cbDiff * 2;
@@ -102,22 +159,128 @@ public:
     int getLength() const {
         return size;
     }
+
+    int getCapacity() const {
+        return static_cast<int>(buffer.capacity());
+    }
+
+    /// heap bytes held by the line, including reserved room
+    size_t getAllocatedBytes() const {
+        return buffer.capacity() * sizeof(Stored);
+    }
+
+    /// block rate, scans the newest count samples and flushes any subnormals among them to zero,
+    /// returns Sample_Health flags
+    uint32_t checkHealth(int count) {
+        count = count < size ? count : size;
+        if(count <= 0) return Healthy;
+        const int start = position - count;
+        // the newest samples end just before position, possibly wrapping around the end
+        Stored* first = buffer.data() + (start < 0 ? size + start : start);
+        const int firstCount = start < 0 ? -start : count;
+        const int secondCount = count - firstCount;
+        const uint32_t flags = Storage::scan(first, firstCount) | Storage::scan(buffer.data(), secondCount);
+        if(flags & Subnormal) {
+            Storage::flushSubnormals(first, firstCount);
+            Storage::flushSubnormals(buffer.data(), secondCount);
+        }
+        return flags;
+    }
+
+    /// never on the audio thread, writes every page of the reserved room so later resizes up to
+    /// capacity never fault, lock pins them (and false lets go again), the samples in the line are kept
+    Residency_Bytes prefault(const bool lock) {
+        Residency_Bytes bytes;
+        if(buffer.capacity() == 0) return bytes;
+        const size_t keep = buffer.size();
+        buffer.resize(buffer.capacity(), Stored());
+        buffer.resize(keep);
+        bytes.touched = getAllocatedBytes();
+        Page_Residency::advise(buffer.data(), bytes.touched);
+        if(lock && !locked) {
+            locked = Page_Residency::lock(buffer.data(), bytes.touched);
+            bytes.lockFailed = !locked;
+        }
+        else if(!lock) {
+            unlock();
+        }
+        if(locked) bytes.locked = bytes.touched;
+        return bytes;
+    }
+
+    void unlock() {
+        if(!locked) return;
+        Page_Residency::unlock(buffer.data(), getAllocatedBytes());
+        locked = false;
+    }
+};
+
+using Circular_Buffer = Basic_Circular_Buffer<Line_Storage>;
+
+/// lowpass for a feedback line, the tpt state variable filter of juce::dsp::StateVariableTPTFilter
+/// with its coefficients pulled out, so lines sharing a cutoff work it out once
+class Line_Filter {
+public:
+    struct Coefficients {
+        float g = 0.f;
+        float R2 = 0.f;
+        float h = 1.f;
+
+        static Coefficients lowpass(const double fs, const float cutoff, const float resonance = 0.707f) {
+            Coefficients c;
+            c.g = static_cast<float>(std::tan(juce::MathConstants<double>::pi * cutoff / fs));
+            c.R2 = static_cast<float>(1.0 / resonance);
+            c.h = static_cast<float>(1.0 / (1.0 + c.R2 * c.g + c.g * c.g));
+            return c;
+        }
+    };
+
+    void setCoefficients(const Coefficients& c) {
+        coefficients = c;
+    }
+
+    void reset() {
+        s1 = 0.f;
+        s2 = 0.f;
+    }
+
+    /// also zeroes a nan
+    void snapToZero() {
+        if(!(s1 < -1.0e-8f || s1 > 1.0e-8f)) s1 = 0.f;
+        if(!(s2 < -1.0e-8f || s2 > 1.0e-8f)) s2 = 0.f;
+    }
+
+    float processSample(const float input) {
+        const Coefficients& c = coefficients;
+        const float highpass = c.h * (input - s1 * (c.g + c.R2) - s2);
+        const float bandpass = highpass * c.g + s1;
+        s1 = highpass * c.g + bandpass;
+        const float lowpass = bandpass * c.g + s2;
+        s2 = bandpass * c.g + lowpass;
+        return lowpass;
+    }
+
+private:
+    Coefficients coefficients;
+    float s1 = 0.f;
+    float s2 = 0.f;
 };
 
-class Single_Delay {
+template<typename Storage>
+class Basic_Single_Delay {
 protected:
-    Circular_Buffer buffer;
+    Basic_Circular_Buffer<Storage> buffer;
     int length = 0;
     float decay = 1.f; /// 1 = no decay, 0 = instant decay
     double sampleRate = 44100;
     float fractional = 0.f;
     //Biquad_Filter filter;
-    juce::dsp::StateVariableTPTFilter<float> filter;
+    Line_Filter filter;
     bool filterIsEnabled = false;
 
 public:
-    Single_Delay() = default;
-    ~Single_Delay() = default;
+    Basic_Single_Delay() = default;
+    ~Basic_Single_Delay() = default;
 
     /*
     Single_Delay(int fs, float time, float decay) {
@@ -134,17 +297,38 @@ public:
         buffer.resize(length);
         buffer.reset();
         decay = dec;
-        juce::dsp::ProcessSpec spec(sampleRate, 512, 1);
         filter.reset();
-        filter.prepare(spec);
-        filter.setType(juce::dsp::StateVariableTPTFilterType::lowpass);
-        filter.setCutoffFrequency(fs / 2.1f);
-        filter.setResonance(0.707);
+        filter.setCoefficients(Line_Filter::Coefficients::lowpass(fs, static_cast<float>(fs / 2.1f)));
         filterIsEnabled = enableFilter;
     }
     
     void reset() {
         buffer.reset();
+        filter.reset();
+    }
+
+    /// the line goes back to the pool until the next prepareToPlay
+    void release() {
+        buffer.release();
+        length = 0;
+    }
+
+    /// room for maxTime seconds, so setTime never allocates up to there
+    void reserve(const double fs, const float maxTime) {
+        const int capacity = juce::roundToInt(static_cast<float>(fs) * maxTime) + 1;
+        if(capacity > buffer.getCapacity()) buffer.reserve(capacity);
+    }
+
+    Residency_Bytes prefault(const bool lock) {
+        return buffer.prefault(lock);
+    }
+
+    /// block rate, a non finite line (or filter) is cleared, Sample_Health flags
+    uint32_t checkHealth(const int count) {
+        const uint32_t flags = buffer.checkHealth(count);
+        if(flags & Non_Finite) reset();
+        else if(filterIsEnabled) filter.snapToZero(); // also zeroes a nan that only reached the filter
+        return flags;
     }
     
     void delay(const float sample) {
@@ -157,7 +341,7 @@ public:
     
     float get() {
         if(filterIsEnabled) {
-            return filter.processSample(0, buffer.getBack());
+            return filter.processSample(buffer.getBack());
         }
         return buffer.getBack();
     }
@@ -192,22 +376,50 @@ public:
         this->decay = decay;
     }
 
-    void setFilterCutoff(float cutoff) {
-        filter.setCutoffFrequency(cutoff);
+    void setFilterCutoff(const float cutoff) {
+        setFilterCoefficients(Line_Filter::Coefficients::lowpass(sampleRate, clampCutoff(cutoff, sampleRate)));
+    }
+
+    void setFilterCoefficients(const Line_Filter::Coefficients& coefficients) {
+        filter.setCoefficients(coefficients);
+    }
+
+    /// keeps the cutoff below nyquist when running at a reduced rate
+    static float clampCutoff(const float cutoff, const double fs) {
+        return juce::jmin(cutoff, static_cast<float>(fs) * 0.45f);
+    }
+
+    size_t getAllocatedBytes() const {
+        return buffer.getAllocatedBytes();
     }
 };
 
+using Single_Delay = Basic_Single_Delay<Line_Storage>;
+
 class Multi_Delay {
 protected:
     double sampleRate = 44100;
     float decay = 0.85; /// 1 = no decay, 0 = instant decay
     float time = 150; /// in ms
-    Mix_Matrix matrix;
-    std::vector<Single_Delay*> delays;
+    Single_Delay delays[NUM_CHANNELS];
     int delaySamples[NUM_CHANNELS] = {0};
     LFO lfos[NUM_CHANNELS];
     float depth = 0.f;
     float fc = 0.f;
+
+    // control rate modulation, the lfos run CONTROL_INTERVAL times faster and are ramped in between
+    static constexpr int CONTROL_INTERVAL = 32;
+    bool controlRate = false;
+    bool controlPrimed = false;
+    int controlCount = 0;
+    float lfoValues[NUM_CHANNELS] = {0.f};
+    float lfoSteps[NUM_CHANNELS] = {0.f};
+    const Kernel_Table* kernels = &Kernel_Dispatch::get(); /// picked for this cpu
+
+    static float lfoRate(const size_t channel) {
+        const float r = static_cast<float>(channel) * 1.f / NUM_CHANNELS;
+        return std::powf(2.f,r) / 2.f;
+    }
     
 public:
     Multi_Delay() = default;
@@ -217,18 +429,17 @@ public:
         sampleRate = fs;
         const float delaySec = t * 0.001f;
         for(size_t i=0; i<NUM_CHANNELS; i++) {
-            delays.push_back(new Single_Delay());
             const float r = i * 1.f / NUM_CHANNELS;
             //delaySamples[i] = std::pow(2,r) * delaySec;
             const float dt = std::powf(2.f,r) * delaySec;
-            delays[i]->prepareToPlay(sampleRate, dt, d, true);
+            delays[i].prepareToPlay(sampleRate, dt, d, true);
             lfos[i].prepareToPlay(sampleRate);
             lfos[i].setType(LFO_type::Sine);
-            const float rate = std::powf(2.f,r) / 2.f;
-            lfos[i].setRate(rate);
+            lfos[i].setRate(lfoRate(i) * (controlRate ? CONTROL_INTERVAL : 1));
         }
         time = t;
         decay = d;
+        fc = 0.f; // the lines were just reset to their default cutoff
         setLFODepth(10.f);
     }
     
@@ -237,7 +448,7 @@ public:
         for(size_t i=0; i<NUM_CHANNELS; i++) {
             const float r = static_cast<float>(i) * 1.f / NUM_CHANNELS;
             const float d = std::powf(2.f,r) * delaySec;
-            delays[i]->setTime(d);
+            delays[i].setTime(d);
         }
     }
     
@@ -255,56 +466,147 @@ public:
         decay = d;
     }
 
+    /// silences every line and restarts the modulation, the delay times are kept
+    void reset() {
+        for(auto& d : delays) {
+            d.reset();
+        }
+        for(auto& lfo : lfos) {
+            lfo.reset();
+        }
+        controlPrimed = false;
+        controlCount = 0;
+    }
+
+    /// audio thread, the lfos are only worked out every CONTROL_INTERVAL samples and ramped
+    /// in between, the phase carries over so switching either way doesn't jump
+    void setControlRateModulation(const bool shouldUseControlRate) {
+        if(shouldUseControlRate == controlRate) return;
+        controlRate = shouldUseControlRate;
+        for(size_t i=0; i<NUM_CHANNELS; i++) {
+            lfos[i].setRate(lfoRate(i) * (controlRate ? CONTROL_INTERVAL : 1));
+        }
+        controlCount = 0;
+    }
+
+    bool isControlRateModulation() const {
+        return controlRate;
+    }
+
+    void release() {
+        for(auto& d : delays) {
+            d.release();
+        }
+    }
+
+    /// room for every line at maxTime ms, so setTime up to there never allocates
+    void reserve(const double fs, const float maxTime) {
+        for(size_t i=0; i<NUM_CHANNELS; i++) {
+            const float r = static_cast<float>(i) * 1.f / NUM_CHANNELS;
+            delays[i].reserve(fs, std::powf(2.f,r) * maxTime * 0.001f);
+        }
+    }
+
+    Residency_Bytes prefault(const bool lock) {
+        Residency_Bytes bytes;
+        for(auto& d : delays) {
+            bytes += d.prefault(lock);
+        }
+        return bytes;
+    }
+
+    /// block rate, count is how many samples each line took since the last check
+    uint32_t checkHealth(const int count, int& linesCleared) {
+        uint32_t flags = Healthy;
+        for(auto& d : delays) {
+            const uint32_t f = d.checkHealth(count);
+            if(f & Non_Finite) linesCleared++;
+            flags |= f;
+        }
+        return flags;
+    }
+
+    /// every line shares the cutoff, so the coefficients are worked out once
     void setFilterCutoff(const float cutoff) {
         if(!juce::approximatelyEqual(cutoff, fc)) {
             fc = cutoff;
+            const auto coefficients = Line_Filter::Coefficients::lowpass(sampleRate, Single_Delay::clampCutoff(fc, sampleRate));
             for(size_t i=0; i<NUM_CHANNELS; i++) {
-                delays[i]->setFilterCutoff(fc);
+                delays[i].setFilterCoefficients(coefficients);
             }
         }
     }
     
-    void delay(const size_t channel, const float sample) const {
-        delays[channel]->delay(sample);
+    void delay(const size_t channel, const float sample) {
+        delays[channel].delay(sample);
     }
     
-    float get(const size_t channel) const {
-        return delays[channel]->get();
+    float get(const size_t channel) {
+        return delays[channel].get();
     }
     
     data getAll() {
         data d;
         for(size_t i=0; i<NUM_CHANNELS; i++) {
-            d.channels[i] = delays[i]->get();
+            d.channels[i] = delays[i].get();
         }
         return d;
     }
     
-    void delayAll(data d) {
+    /// evaluates the expression straight into the lines
+    template<typename E>
+    void delayAll(const Frame_Expr<E>& e) {
+        const E& d = static_cast<const E&>(e);
         for(size_t i=0; i<NUM_CHANNELS; i++) {
-            delays[i]->delay(d.channels[i]);
+            delays[i].delay(d[i]);
         }
     }
     
     data process(const data &input) {
         const data output = getAll();
         //for(int i=0; i<NUM_CHANNELS; i++) output.channels[i] = delays[i].getAt(delaySamples[i]);
-        const data mixed = matrix.Householder(output);
-        for(size_t i=0; i<NUM_CHANNELS; i++) {
-            const float sum = input.channels[i] + (mixed.channels[i] * decay * lfos[i].getValue());
-            delay(i, sum);
+        if(!controlRate) {
+            for(size_t i=0; i<NUM_CHANNELS; i++) {
+                lfoValues[i] = lfos[i].getValue();
+            }
+            controlPrimed = true;
         }
+        else {
+            if(controlCount == 0) {
+                for(size_t i=0; i<NUM_CHANNELS; i++) {
+                    const float next = lfos[i].getValue();
+                    if(!controlPrimed) lfoValues[i] = next;
+                    lfoSteps[i] = (next - lfoValues[i]) / CONTROL_INTERVAL;
+                }
+                controlPrimed = true;
+            }
+            for(size_t i=0; i<NUM_CHANNELS; i++) {
+                lfoValues[i] += lfoSteps[i];
+            }
+            controlCount = (controlCount + 1) % CONTROL_INTERVAL;
+        }
+        data write;
+        kernels->feedback(input, output, decay, lfoValues, write);
+        delayAll(write);
         return output;
     }
+
+    size_t getAllocatedBytes() const {
+        size_t bytes = 0;
+        for(const auto& d : delays) {
+            bytes += d.getAllocatedBytes();
+        }
+        return bytes;
+    }
 };
 
 class DiffusionStep {
 protected:
     bool flipPolarity[NUM_CHANNELS] = {false};
-    std::vector<Single_Delay*> delays;
+    Basic_Single_Delay<Diffusion_Storage> delays[NUM_CHANNELS];
     Mix_Matrix matrix;
     int delaySamples[NUM_CHANNELS] = {0};
-    std::random_device rd;
+    std::mt19937 gen;
     
 public:
     int delayRange = 150; /// in ms
@@ -312,32 +614,59 @@ public:
     DiffusionStep() = default;
     ~DiffusionStep() = default;
     
-    void configure(double fs) {
+    /// the same seed always gives the same delay times and polarities
+    void configure(double fs, const uint32_t seed) {
+        gen.seed(seed);
         float delayTime = static_cast<float>(delayRange) * 0.001f;
-        //delays.resize(NUM_CHANNELS);
         for(int i=0; i<NUM_CHANNELS; i++) {
-            delays.push_back(new Single_Delay());
             const float low = delayTime * static_cast<float>(i) / NUM_CHANNELS;
             const float high = delayTime * static_cast<float>(i+1) / NUM_CHANNELS;
             //delaySamples[i] = randomInRange(low, high);
             float d = randomInRange(low, high);
             if(d<0.001f) d = 0.001f;
-            delays[i]->prepareToPlay(fs, d, 1.f, false);
-            flipPolarity[i] = rand() % 2;
+            delays[i].prepareToPlay(fs, d, 1.f, false);
+            flipPolarity[i] = (gen() & 1u) != 0;
         }
     }
     
+    void reset() {
+        for(auto& d : delays) {
+            d.reset();
+        }
+    }
+
+    void release() {
+        for(auto& d : delays) {
+            d.release();
+        }
+    }
+
+    /// room for configure() with delayRange up to maxRange ms
+    void reserve(const double fs, const float maxRange) {
+        for(int i=0; i<NUM_CHANNELS; i++) {
+            delays[i].reserve(fs, maxRange * 0.001f * static_cast<float>(i+1) / NUM_CHANNELS);
+        }
+    }
+
+    Residency_Bytes prefault(const bool lock) {
+        Residency_Bytes bytes;
+        for(auto& d : delays) {
+            bytes += d.prefault(lock);
+        }
+        return bytes;
+    }
+
     data getAll() {
         data d;
         for(size_t i=0; i<NUM_CHANNELS; i++) {
-            d.channels[i] = delays[i]->get();
+            d.channels[i] = delays[i].get();
         }
         return d;
     }
     
-    void delayAll(const data &input) const {
+    void delayAll(const data &input) {
         for(int i=0; i<NUM_CHANNELS; i++) {
-            delays[i]->delay(input.channels[i]);
+            delays[i].delay(input.channels[i]);
         }
     }
     
@@ -362,39 +691,209 @@ public:
     */
 
     float randomInRange(float a, float b) {
-        std::mt19937 gen(rd());
         std::uniform_real_distribution<float> dist(a, b);
         return dist(gen);
     }
+    size_t getAllocatedBytes() const {
+        size_t bytes = 0;
+        for(const auto& d : delays) {
+            bytes += d.getAllocatedBytes();
+        }
+        return bytes;
+    }
 };
 
-class Diffuser {
+/// schroeder allpasses in series for a single channel, cheap enough to run at the host rate
+class Allpass_Chain {
 protected:
+    static constexpr int NUM_STAGES = 3;
+    static constexpr float ratios[NUM_STAGES] = {1.f, 0.77f, 0.59f};
+    Basic_Circular_Buffer<Diffusion_Storage> buffers[NUM_STAGES];
+    float gain = 0.6f;
+
+public:
+    Allpass_Chain() = default;
+    ~Allpass_Chain() = default;
+
+    /// spread sets the longest stage relative to timeMS, so two chains can decorrelate
+    void prepareToPlay(const double fs, const float timeMS, const float spread, const float g) {
+        for(size_t i=0; i<NUM_STAGES; i++) {
+            const int length = juce::roundToInt(static_cast<float>(fs) * timeMS * 0.001f * ratios[i] * spread);
+            buffers[i].resize(length > 1 ? length : 1);
+            buffers[i].reset();
+        }
+        gain = g;
+    }
+
+    void reset() {
+        for(auto& b : buffers) {
+            b.reset();
+        }
+    }
+
+    void release() {
+        for(auto& b : buffers) {
+            b.release();
+        }
+    }
+
+    Residency_Bytes prefault(const bool lock) {
+        Residency_Bytes bytes;
+        for(auto& b : buffers) {
+            bytes += b.prefault(lock);
+        }
+        return bytes;
+    }
+
+    float process(float x) {
+        for(auto& b : buffers) {
+            const float delayed = b.getBack();
+            const float y = delayed - gain * x;
+            b.add(x + gain * y);
+            x = y;
+        }
+        return x;
+    }
+    size_t getAllocatedBytes() const {
+        size_t bytes = 0;
+        for(const auto& b : buffers) {
+            bytes += b.getAllocatedBytes();
+        }
+        return bytes;
+    }
+};
+
+class Diffuser {
+public:
     static constexpr int NUM_STEPS = 4;
-    std::vector<DiffusionStep*> steps;
+
+protected:
+    static constexpr int SHORT_STEPS = 2; /// the shortest steps, all a shortened diffuser runs
+    static constexpr float FADE_MS = 50.f;
+    DiffusionStep steps[NUM_STEPS][2]; /// the copy in use and a spare that configureStep builds into
+    int active[NUM_STEPS] = {0};
+    uint32_t built = 0; /// spares configured since the last swapSteps
+    float longGain = 1.f; /// how much of the full output is heard over the shortened one
+    float longTarget = 1.f;
+    float fadeStep = 0.001f;
+
+    DiffusionStep& step(const size_t i) {
+        return steps[i][active[i]];
+    }
+
+    static void configure(DiffusionStep& s, const int step, const float diffusionMS, const double fs, const uint32_t seed) {
+        s.delayRange = juce::roundToInt(std::ldexp(diffusionMS, step - (NUM_STEPS - 1)));
+        s.configure(fs, seed + static_cast<uint32_t>(step + 1) * 0x9E3779B9u);
+    }
     
 public:
     Diffuser() = default;
     ~Diffuser() = default;
     
-    void prepareToPlay(float diffusionMS, double fs) {
-        //steps.resize(NUM_STEPS);
+    /// seed picks the topology, so a render elsewhere can reproduce this diffuser exactly,
+    /// the spares are sized as well so a later rebuild never allocates
+    void prepareToPlay(const float diffusionMS, const double fs, const uint32_t seed) {
+        fadeStep = 1.f / static_cast<float>(fs * FADE_MS * 0.001f);
+        for(int i=NUM_STEPS-1; i>=0; i--) {
+            for(auto& s : steps[i]) {
+                configure(s, i, diffusionMS, fs, seed);
+            }
+        }
+        built = 0;
+    }
+
+    /// rebuilds a single step into its spare, so a room size change can be spread over several blocks
+    /// without touching what is heard, each step spans half the time of the one after it
+    void configureStep(const int step, const float diffusionMS, const double fs, const uint32_t seed) {
+        configure(steps[step][1 - active[step]], step, diffusionMS, fs, seed);
+        built |= 1u << step;
+    }
+
+    /// every step configureStep rebuilt goes in at once, from silence
+    void swapSteps() {
+        for(int i=0; i<NUM_STEPS; i++) {
+            if(built & (1u << i)) active[i] = 1 - active[i];
+        }
+        built = 0;
+    }
+    
+    void reset() {
         for(size_t i=0; i<NUM_STEPS; i++) {
-            steps.push_back(new DiffusionStep());
+            step(i).reset();
+        }
+        longGain = longTarget;
+    }
+
+    /// audio thread, crossfades to (or back from) the output of the shortest steps,
+    /// the longest steps stop running once they are faded out
+    void setShortened(const bool shouldShorten) {
+        const float target = shouldShorten ? 0.f : 1.f;
+        if(juce::approximatelyEqual(target, longTarget)) return;
+        // stopped where they were, so they come back from silence
+        if(!shouldShorten && longGain <= 0.f) {
+            for(size_t i=SHORT_STEPS; i<NUM_STEPS; i++) {
+                step(i).reset();
+            }
         }
+        longTarget = target;
+    }
+
+    bool isShortened() const {
+        return longTarget < 1.f;
+    }
+
+    void release() {
+        for(auto& pair : steps) {
+            for(auto& s : pair) {
+                s.release();
+            }
+        }
+    }
+
+    /// room for prepareToPlay with diffusionMS up to maxDiffusionMS
+    void reserve(float maxDiffusionMS, const double fs) {
         for(size_t i=NUM_STEPS; i>0; i--) {
-            steps[i-1]->delayRange = juce::roundToInt(diffusionMS);
-            steps[i-1]->configure(fs);
-            diffusionMS *= 0.5;
+            for(auto& s : steps[i-1]) {
+                s.reserve(fs, static_cast<float>(juce::roundToInt(maxDiffusionMS)));
+            }
+            maxDiffusionMS *= 0.5;
         }
     }
-    
-    data process(const data &input) const {
+
+    Residency_Bytes prefault(const bool lock) {
+        Residency_Bytes bytes;
+        for(auto& pair : steps) {
+            for(auto& s : pair) {
+                bytes += s.prefault(lock);
+            }
+        }
+        return bytes;
+    }
+
+    data process(const data &input) {
         data o = input;
-        for(size_t i=0; i<NUM_STEPS; i++) {
-            o = steps[i]->process(o);
+        for(size_t i=0; i<SHORT_STEPS; i++) {
+            o = step(i).process(o);
+        }
+        if(longGain <= 0.f && longTarget <= 0.f) return o;
+        const data shortOutput = o;
+        for(size_t i=SHORT_STEPS; i<NUM_STEPS; i++) {
+            o = step(i).process(o);
+        }
+        if(longGain < longTarget) longGain = std::min(longGain + fadeStep, longTarget);
+        else if(longGain > longTarget) longGain = std::max(longGain - fadeStep, longTarget);
+        else return o;
+        return shortOutput + (o - shortOutput) * longGain;
+    }
+
+    size_t getAllocatedBytes() const {
+        size_t bytes = 0;
+        for(const auto& pair : steps) {
+            for(const auto& s : pair) {
+                bytes += s.getAllocatedBytes();
+            }
         }
-        return o;
+        return bytes;
     }
 };
 
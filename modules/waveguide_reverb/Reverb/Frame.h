@@ -0,0 +1,207 @@
+#ifndef COLIN_FRAME_H
+#define COLIN_FRAME_H
+#include <cstddef>
+#include <type_traits>
+
+/*
+  ==============================================================================
+
+    Frame.h
+
+    one sample across every channel of the network, arithmetic on frames
+    builds an expression that is only evaluated when it's assigned or
+    written somewhere, so a chain of adds and scales is a single loop
+    with no frames in between
+
+  ==============================================================================
+*/
+
+namespace Colin
+{
+
+static constexpr int NUM_CHANNELS = 16;
+
+/// anything that gives a value per channel, evaluated lazily
+template<typename E>
+struct Frame_Expr {
+    float operator[](const size_t i) const {
+        return static_cast<const E&>(*this)[i];
+    }
+};
+
+struct data;
+
+/// frames are held by reference, expressions (a few floats and references) by value
+template<typename E>
+using Frame_Operand = std::conditional_t<std::is_same_v<E, data>, const data&, const E>;
+
+struct alignas(64) data : Frame_Expr<data> {
+    float channels[NUM_CHANNELS] = {0.f};
+
+    data() = default;
+    data(const data&) = default;
+    data& operator=(const data&) = default;
+
+    template<typename E>
+    data(const Frame_Expr<E>& e) {
+        assign(e);
+    }
+
+    /// every expression here is per channel, so assigning one that reads this frame is safe
+    template<typename E>
+    data& operator=(const Frame_Expr<E>& e) {
+        assign(e);
+        return *this;
+    }
+
+    template<typename E>
+    data& operator+=(const Frame_Expr<E>& e) {
+        const E& expr = static_cast<const E&>(e);
+        for(size_t i=0; i<NUM_CHANNELS; i++) {
+            channels[i] += expr[i];
+        }
+        return *this;
+    }
+
+    data& operator*=(const float scalar) {
+        for(size_t i=0; i<NUM_CHANNELS; i++) {
+            channels[i] *= scalar;
+        }
+        return *this;
+    }
+
+    float operator[](const size_t i) const {
+        return channels[i];
+    }
+
+    void fill(float input) {
+        for(size_t i=0; i<NUM_CHANNELS; i++) {
+            channels[i] = input;
+        }
+    }
+
+    void scale(float scalar) {
+        *this *= scalar;
+    }
+
+private:
+    template<typename E>
+    void assign(const Frame_Expr<E>& e) {
+        const E& expr = static_cast<const E&>(e);
+        for(size_t i=0; i<NUM_CHANNELS; i++) {
+            channels[i] = expr[i];
+        }
+    }
+};
+
+/// a plain array of NUM_CHANNELS floats, e.g. the lfo values
+struct Frame_Lanes : Frame_Expr<Frame_Lanes> {
+    const float* values;
+    explicit Frame_Lanes(const float* v) : values(v) {}
+    float operator[](const size_t i) const { return values[i]; }
+};
+
+inline Frame_Lanes lanes(const float* values) {
+    return Frame_Lanes(values);
+}
+
+template<typename A, typename B>
+struct Frame_Sum : Frame_Expr<Frame_Sum<A, B>> {
+    Frame_Operand<A> a;
+    Frame_Operand<B> b;
+    Frame_Sum(const A& x, const B& y) : a(x), b(y) {}
+    float operator[](const size_t i) const { return a[i] + b[i]; }
+};
+
+template<typename A, typename B>
+struct Frame_Difference : Frame_Expr<Frame_Difference<A, B>> {
+    Frame_Operand<A> a;
+    Frame_Operand<B> b;
+    Frame_Difference(const A& x, const B& y) : a(x), b(y) {}
+    float operator[](const size_t i) const { return a[i] - b[i]; }
+};
+
+/// per channel product
+template<typename A, typename B>
+struct Frame_Product : Frame_Expr<Frame_Product<A, B>> {
+    Frame_Operand<A> a;
+    Frame_Operand<B> b;
+    Frame_Product(const A& x, const B& y) : a(x), b(y) {}
+    float operator[](const size_t i) const { return a[i] * b[i]; }
+};
+
+template<typename A>
+struct Frame_Scaled : Frame_Expr<Frame_Scaled<A>> {
+    Frame_Operand<A> a;
+    float scalar;
+    Frame_Scaled(const A& x, const float s) : a(x), scalar(s) {}
+    float operator[](const size_t i) const { return a[i] * scalar; }
+};
+
+/// a * b + c per channel, left to the compiler to contract
+template<typename A, typename B, typename C>
+struct Frame_Multiply_Add : Frame_Expr<Frame_Multiply_Add<A, B, C>> {
+    Frame_Operand<A> a;
+    Frame_Operand<B> b;
+    Frame_Operand<C> c;
+    Frame_Multiply_Add(const A& x, const B& y, const C& z) : a(x), b(y), c(z) {}
+    float operator[](const size_t i) const { return a[i] * b[i] + c[i]; }
+};
+
+/// the householder reflection, every output needs the sum of every input so that is taken
+/// up front, an operand that isn't already a frame is evaluated into one first
+template<typename E>
+struct Frame_Householder : Frame_Expr<Frame_Householder<E>> {
+    std::conditional_t<std::is_same_v<E, data>, const data&, const data> in;
+    float shift = 0.f;
+
+    explicit Frame_Householder(const E& e) : in(e) {
+        // pairwise, the same order whatever the vector width
+        float sum[NUM_CHANNELS / 2];
+        for(size_t i=0; i<NUM_CHANNELS / 2; i++) sum[i] = in.channels[i] + in.channels[i + NUM_CHANNELS / 2];
+        for(size_t i=0; i<NUM_CHANNELS / 4; i++) sum[i] += sum[i + NUM_CHANNELS / 4];
+        for(size_t i=0; i<NUM_CHANNELS / 8; i++) sum[i] += sum[i + NUM_CHANNELS / 8];
+        shift = (sum[0] + sum[1]) * (-2.f / NUM_CHANNELS);
+    }
+
+    float operator[](const size_t i) const { return in.channels[i] + shift; }
+};
+
+template<typename A, typename B>
+Frame_Sum<A, B> operator+(const Frame_Expr<A>& a, const Frame_Expr<B>& b) {
+    return {static_cast<const A&>(a), static_cast<const B&>(b)};
+}
+
+template<typename A, typename B>
+Frame_Difference<A, B> operator-(const Frame_Expr<A>& a, const Frame_Expr<B>& b) {
+    return {static_cast<const A&>(a), static_cast<const B&>(b)};
+}
+
+template<typename A, typename B>
+Frame_Product<A, B> operator*(const Frame_Expr<A>& a, const Frame_Expr<B>& b) {
+    return {static_cast<const A&>(a), static_cast<const B&>(b)};
+}
+
+template<typename A>
+Frame_Scaled<A> operator*(const Frame_Expr<A>& a, const float scalar) {
+    return {static_cast<const A&>(a), scalar};
+}
+
+template<typename A>
+Frame_Scaled<A> operator*(const float scalar, const Frame_Expr<A>& a) {
+    return {static_cast<const A&>(a), scalar};
+}
+
+template<typename A, typename B, typename C>
+Frame_Multiply_Add<A, B, C> multiplyAdd(const Frame_Expr<A>& a, const Frame_Expr<B>& b, const Frame_Expr<C>& c) {
+    return {static_cast<const A&>(a), static_cast<const B&>(b), static_cast<const C&>(c)};
+}
+
+template<typename E>
+Frame_Householder<E> householder(const Frame_Expr<E>& e) {
+    return Frame_Householder<E>(static_cast<const E&>(e));
+}
+
+}
+
+#endif
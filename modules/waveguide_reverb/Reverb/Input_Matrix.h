@@ -0,0 +1,217 @@
+#ifndef COLIN_INPUT_MATRIX_H
+#define COLIN_INPUT_MATRIX_H
+#include <cmath>
+#include "juce_audio_basics/juce_audio_basics.h"
+#include "Delay.h"
+#include "Frame.h"
+
+/*
+  ==============================================================================
+
+    Input_Matrix.h
+
+    the main input and any send buses into the network's sixteen lines,
+    each bus has its own pre delay and its own pair of injection vectors
+    (how its left and right feed each line), so several sources share
+    one diffuser and feedback network but still excite it differently
+
+  ==============================================================================
+*/
+
+namespace Colin
+{
+
+class Input_Matrix {
+public:
+    static constexpr int MAX_BUSES = 8; /// the main input and seven sends
+    static constexpr float MAX_PRE_DELAY_MS = 500.f;
+    static constexpr float FADE_MS = 10.f; /// a pre delay change crossfades from the old read position over this
+
+    Input_Matrix() {
+        for(int bus = 0; bus < MAX_BUSES; bus++) {
+            defaultInjection(bus, buses[bus].left, buses[bus].right);
+        }
+    }
+
+    /// the main input's pattern (Mix_Matrix::stereoToMulti) turned by the golden angle once per bus,
+    /// every bus injects the same energy
+    static void defaultInjection(const int bus, data& left, data& right) {
+        const double turn = M_PI * (3.0 - std::sqrt(5.0)) * bus;
+        for(size_t i = 0; i < NUM_CHANNELS / 2; i++) {
+            const double phase = M_PI * static_cast<double>(i) / NUM_CHANNELS + turn;
+            const float c = static_cast<float>(std::cos(phase));
+            const float s = static_cast<float>(std::sin(phase));
+            left.channels[2*i] = c;
+            left.channels[2*i + 1] = -s;
+            right.channels[2*i] = s;
+            right.channels[2*i + 1] = c;
+        }
+    }
+
+    /// message thread, takes effect at the next prepare, where a send (bus 1 on) sits in the
+    /// buffer the engine processes, no channels turns it off, a mono send goes in as left and inverted right
+    void setRouting(const int bus, const int firstChannel, const int numChannels) {
+        jassert(bus > 0 && bus < MAX_BUSES);
+        requested[bus] = {juce::jmax(0, firstChannel), juce::jlimit(0, 2, numChannels)};
+    }
+
+    /// audio thread, clamped to MAX_PRE_DELAY_MS, crossfades to the new time over FADE_MS,
+    /// a change during a fade starts once that fade is done
+    void setPreDelay(const int bus, const float ms) {
+        Bus& b = buses[bus];
+        b.preDelayMS = juce::jlimit(0.f, MAX_PRE_DELAY_MS, ms);
+        b.targetSamples = juce::jmin(capacity - 1, juce::roundToInt(sampleRate * b.preDelayMS * 0.001));
+    }
+
+    /// audio thread
+    void setInjection(const int bus, const data& left, const data& right) {
+        buses[bus].left = left;
+        buses[bus].right = right;
+    }
+
+    /// while audio is stopped, the main input only gets a pre delay line when there are sends to line it up with
+    void prepare(const double fs) {
+        sampleRate = fs;
+        capacity = juce::roundToInt(fs * MAX_PRE_DELAY_MS * 0.001) + 1;
+        fadeLength = juce::jmax(1, juce::roundToInt(fs * FADE_MS * 0.001));
+        sending = false;
+        requiredChannels = 0;
+        for(int bus = 1; bus < MAX_BUSES; bus++) {
+            buses[bus].routing = requested[bus];
+            const Routing& routing = buses[bus].routing;
+            if(routing.numChannels == 0) continue;
+            sending = true;
+            requiredChannels = juce::jmax(requiredChannels, routing.firstChannel + routing.numChannels);
+        }
+        for(int bus = 0; bus < MAX_BUSES; bus++) {
+            Bus& b = buses[bus];
+            const bool used = sending && (bus == 0 || b.routing.numChannels > 0);
+            for(auto& line : b.lines) {
+                if(used) {
+                    line.resize(capacity);
+                    line.reset();
+                }
+                else if(line.getAllocatedBytes() > 0) {
+                    line.release();
+                }
+            }
+            // nothing is playing yet, so no fade
+            setPreDelay(bus, b.preDelayMS);
+            b.delaySamples = b.targetSamples;
+            b.fadeRemaining = 0;
+        }
+    }
+
+    void reset() {
+        for(auto& b : buses) {
+            for(auto& line : b.lines) line.reset();
+            b.delaySamples = b.targetSamples;
+            b.fadeRemaining = 0;
+        }
+    }
+
+    /// message thread while audio is stopped
+    void release() {
+        for(auto& b : buses) {
+            for(auto& line : b.lines) line.release();
+        }
+        sending = false;
+    }
+
+    /// whether the last prepare found any send in use
+    bool hasSends() const {
+        return sending;
+    }
+
+    /// how many channels the buffer needs for every send to be there
+    int getRequiredChannels() const {
+        return requiredChannels;
+    }
+
+    size_t getAllocatedBytes() const {
+        size_t bytes = 0;
+        for(const auto& b : buses) {
+            for(const auto& line : b.lines) bytes += line.getAllocatedBytes();
+        }
+        return bytes;
+    }
+
+    /// audio thread, with sends only, frames gets every bus's input summed, mainR is nullptr for a mono main input
+    void process(const juce::AudioBuffer<float>& buffer, const int startSample, const int numSamples, const float* mainL, const float* mainR, data* frames) {
+        std::fill_n(frames, numSamples, data());
+        for(int bus = 0; bus < MAX_BUSES; bus++) {
+            Bus& b = buses[bus];
+            const float* inL = mainL;
+            const float* inR = mainR;
+            if(bus > 0) {
+                if(b.routing.numChannels == 0) continue;
+                inL = buffer.getReadPointer(b.routing.firstChannel, startSample);
+                inR = b.routing.numChannels > 1 ? buffer.getReadPointer(b.routing.firstChannel + 1, startSample) : nullptr;
+            }
+            if(b.fadeRemaining > 0 || b.targetSamples != b.delaySamples) {
+                processFading(b, inL, inR, frames, numSamples);
+                continue;
+            }
+            // the newest sample is one behind the write position
+            const int offset = -1 - b.delaySamples;
+            for(int i = 0; i < numSamples; i++) {
+                b.lines[0].add(inL[i]);
+                b.lines[1].add(inR != nullptr ? inR[i] : -inL[i]);
+                frames[i] += b.lines[0].getOffset(offset) * b.left + b.lines[1].getOffset(offset) * b.right;
+            }
+        }
+    }
+
+private:
+    struct Routing {
+        int firstChannel = 0;
+        int numChannels = 0;
+    };
+
+    struct Bus {
+        Routing routing;
+        float preDelayMS = 0.f;
+        int delaySamples = 0;  /// where the bus is read, or fading to
+        int targetSamples = 0; /// where the next fade goes
+        int fadeFrom = 0;
+        int fadeRemaining = 0;
+        data left;
+        data right;
+        Basic_Circular_Buffer<Float_Storage> lines[2];
+    };
+
+    /// the same as the plain loop, reading from both positions while a fade runs and starting the next one when it ends
+    void processFading(Bus& b, const float* inL, const float* inR, data* frames, const int numSamples) {
+        const float step = 1.f / static_cast<float>(fadeLength);
+        for(int i = 0; i < numSamples; i++) {
+            if(b.fadeRemaining == 0 && b.targetSamples != b.delaySamples) {
+                b.fadeFrom = b.delaySamples;
+                b.delaySamples = b.targetSamples;
+                b.fadeRemaining = fadeLength;
+            }
+            b.lines[0].add(inL[i]);
+            b.lines[1].add(inR != nullptr ? inR[i] : -inL[i]);
+            float left = b.lines[0].getOffset(-1 - b.delaySamples);
+            float right = b.lines[1].getOffset(-1 - b.delaySamples);
+            if(b.fadeRemaining > 0) {
+                const float old = static_cast<float>(b.fadeRemaining) * step;
+                left += old * (b.lines[0].getOffset(-1 - b.fadeFrom) - left);
+                right += old * (b.lines[1].getOffset(-1 - b.fadeFrom) - right);
+                b.fadeRemaining--;
+            }
+            frames[i] += left * b.left + right * b.right;
+        }
+    }
+
+    Bus buses[MAX_BUSES];
+    Routing requested[MAX_BUSES]; /// message thread
+    double sampleRate = 44100.0;
+    int capacity = 1;
+    int fadeLength = 1;
+    int requiredChannels = 0;
+    bool sending = false;
+};
+
+}
+
+#endif
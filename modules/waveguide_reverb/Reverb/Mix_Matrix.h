@@ -2,6 +2,8 @@
 #define COLIN_MIX_MATRIX_H
 #include <cmath>
 #include <random>
+#include "../Utility/Kernels.h"
+#include "Frame.h"
 
 /*
   ==============================================================================
@@ -16,28 +18,11 @@
 namespace Colin
 {
 
-static constexpr int NUM_CHANNELS = 16;
-
-struct data {
-    float channels[NUM_CHANNELS] = {0.f};
-    
-    void fill(float input) {
-        for(size_t i=0; i<NUM_CHANNELS; i++) {
-            channels[i] = input;
-        }
-    }
-
-    void scale(float scalar) {
-        for(size_t i=0; i<NUM_CHANNELS; i++) {
-            channels[i] = channels[i]*scalar;
-        }
-    }
-};
-
 class Mix_Matrix {
 protected:
     float coeffs[NUM_CHANNELS] = {0};
     std::random_device rd;
+    const Kernel_Table* kernels = &Kernel_Dispatch::get(); /// picked for this cpu
 
 public:
     Mix_Matrix() {
@@ -51,55 +36,19 @@ public:
     }
     ~Mix_Matrix() = default;
     
-    data Householder(data r) {
-        data o;
-        float factor = -2.f / NUM_CHANNELS;
-        float sum = 0.f;
-        for(int i=0; i<NUM_CHANNELS; i++)
-            sum += r.channels[i];
-        sum *= factor;
-        for(size_t i=0; i<NUM_CHANNELS; i++) {
-            o.channels[i] = r.channels[i] + sum;
-        }
-        return o;
+    data Householder(const data& r) {
+        return householder(r);
     }
     
-    data Hadamard(data r) {
-        float a = 0;
-        float b = 0;
-        //data* point = &r;
-        recursiveUnscaled(&r, NUM_CHANNELS);
-        data o = r;
-        float factor = std::sqrt(1.f/NUM_CHANNELS);
-        for(size_t i=0; i<NUM_CHANNELS; i++) {
-            o.channels[i] *= factor;
-        }
+    data Hadamard(const data& r) {
+        data o;
+        kernels->hadamard(r.channels, o.channels);
         return o;
     }
 
-    void recursiveUnscaled(data* r, int size) {
-        if (size <= 1) return;
-        int hSize = size/2;
-
-        // Two (unscaled) Hadamards of half the size
-        recursiveUnscaled(r, hSize);
-        recursiveUnscaled(r + hSize, hSize);
-
-        // Combine the two halves using sum/difference
-        for (int i = 0; i < hSize; ++i) {
-            double a = r->channels[i];
-            double b = r->channels[i + hSize];
-            r->channels[i] = (a + b);
-            r->channels[i + hSize] = (a - b);
-        }
-    }
-
-    data intermix(data f, data m, float fCoeff, float mCoeff) {
-        data o;
-        for(size_t i=0; i<NUM_CHANNELS; i++) {
-            o.channels[i] = fCoeff * f.channels[i] + mCoeff * m.channels[i];
-        }
-        return o;
+    /// lazy, the frames have to outlive the result
+    auto intermix(const data& f, const data& m, float fCoeff, float mCoeff) {
+        return fCoeff * f + mCoeff * m;
         /*
         data o;
         std::mt19937 gen(rd());
@@ -128,7 +77,28 @@ public:
         return o;
     }
     
-    void multiToStereo(data input, float &l, float &r) {
+    /// the same as stereoToMulti(x, -x) without the right side's multiplies
+    data monoToMulti(float x) {
+        data o;
+        o.channels[0] = x;
+        o.channels[1] = -x;
+        for(size_t i=2; i<NUM_CHANNELS; i+=2) {
+            o.channels[i] = x * coeffs[i] - x * coeffs[i+1];
+            o.channels[i+1] = -(x * coeffs[i] + x * coeffs[i+1]);
+        }
+        return o;
+    }
+
+    /// the left side of multiToStereo
+    float multiToMono(const data& input) {
+        float l = input.channels[0];
+        for(size_t i=2; i<NUM_CHANNELS; i+=2) {
+            l += input.channels[i] * coeffs[i] - input.channels[i+1] * coeffs[i+1];
+        }
+        return l;
+    }
+
+    void multiToStereo(const data& input, float &l, float &r) {
         l = input.channels[0];
         r = input.channels[1];
         for(size_t i=2; i<NUM_CHANNELS; i+=2) {
@@ -139,12 +109,9 @@ public:
         //r *= std::sqrt(2.0/NUM_CHANNELS);
     }
 
-    data combine(const data &one, const data &two) {
-        data o;
-        for(size_t i=0; i<NUM_CHANNELS; i++) {
-            o.channels[i] = one.channels[i] + two.channels[i];
-        }
-        return o;
+    /// lazy, the frames have to outlive the result
+    auto combine(const data &one, const data &two) {
+        return one + two;
     }
     
     void cheapEnergyCrossfade(float x, float &toCoeff, float &fromCoeff) {
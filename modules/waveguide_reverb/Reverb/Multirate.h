@@ -0,0 +1,237 @@
+#ifndef COLIN_MULTIRATE_H
+#define COLIN_MULTIRATE_H
+#include <algorithm>
+#include <cmath>
+
+/*
+  ==============================================================================
+
+    Multirate.h
+
+    polyphase halfband decimation and interpolation, so the late reverb
+    can run at 1/2 or 1/4 of the host rate
+
+  ==============================================================================
+*/
+
+namespace Colin
+{
+
+/// 31 tap windowed sinc halfband, every even offset from the centre is zero
+struct Halfband {
+    static constexpr int TAPS = 31;
+    static constexpr int CENTRE = TAPS / 2;
+    static constexpr int NUM_SIDE = (CENTRE + 1) / 2; /// non zero taps either side of the centre
+
+    /// side[j] is the tap at offset +-(2j + 1), the centre tap is 0.5
+    float side[NUM_SIDE] = {0.f};
+
+    Halfband() {
+        const double pi = 3.14159265358979323846;
+        double sum = 0.0;
+        for(int j=0; j<NUM_SIDE; j++) {
+            const int offset = 2 * j + 1;
+            const double n = static_cast<double>(CENTRE + offset);
+            const double window = 0.42 - 0.5 * std::cos(2.0 * pi * n / (TAPS - 1)) + 0.08 * std::cos(4.0 * pi * n / (TAPS - 1));
+            const double sinc = std::sin(pi * offset * 0.5) / (pi * offset);
+            side[j] = static_cast<float>(sinc * window);
+            sum += 2.0 * side[j];
+        }
+        // unity gain at dc, the centre tap stays exactly 0.5
+        for(int j=0; j<NUM_SIDE; j++) {
+            side[j] = static_cast<float>(side[j] * 0.5 / sum);
+        }
+    }
+
+    static const Halfband& get() {
+        static const Halfband filter;
+        return filter;
+    }
+};
+
+/// halves the rate, push() every input frame and compute() every second one
+template<int NumChannels>
+class Halfband_Decimator {
+public:
+    Halfband_Decimator() {
+        reset();
+    }
+    ~Halfband_Decimator() = default;
+
+    void reset() {
+        std::fill(&history[0][0], &history[0][0] + NumChannels * 2 * Halfband::TAPS, 0.f);
+        pos = 0;
+        silent = Halfband::TAPS;
+    }
+
+    /// nullptr pushes a silent frame, once the history is all silence compute() costs nothing
+    void push(const float* in) {
+        if(in == nullptr && silent >= Halfband::TAPS) {
+            // the history is already all zeros
+            pos = (pos + 1) % Halfband::TAPS;
+            return;
+        }
+        for(int ch=0; ch<NumChannels; ch++) {
+            const float x = in != nullptr ? in[ch] : 0.f;
+            history[ch][pos] = x;
+            history[ch][pos + Halfband::TAPS] = x;
+        }
+        silent = in != nullptr ? 0 : std::min(silent + 1, Halfband::TAPS);
+        pos = (pos + 1) % Halfband::TAPS;
+    }
+
+    void compute(float* out) const {
+        if(silent >= Halfband::TAPS) {
+            std::fill(out, out + NumChannels, 0.f);
+            return;
+        }
+        const auto& filter = Halfband::get();
+        for(int ch=0; ch<NumChannels; ch++) {
+            // oldest first, x[TAPS - 1] is the newest frame
+            const float* x = history[ch] + pos;
+            float y = 0.5f * x[Halfband::CENTRE];
+            for(int j=0; j<Halfband::NUM_SIDE; j++) {
+                const int offset = 2 * j + 1;
+                y += filter.side[j] * (x[Halfband::CENTRE - offset] + x[Halfband::CENTRE + offset]);
+            }
+            out[ch] = y;
+        }
+    }
+
+private:
+    float history[NumChannels][2 * Halfband::TAPS];
+    int pos = 0;
+    int silent = 0;
+};
+
+/// doubles the rate, one low rate frame in gives two frames out
+template<int NumChannels>
+class Halfband_Interpolator {
+public:
+    static constexpr int LENGTH = Halfband::NUM_SIDE * 2; /// low rate frames the filter spans
+
+    Halfband_Interpolator() {
+        reset();
+    }
+    ~Halfband_Interpolator() = default;
+
+    void reset() {
+        std::fill(&history[0][0], &history[0][0] + NumChannels * 2 * LENGTH, 0.f);
+        pos = 0;
+    }
+
+    void process(const float* in, float* first, float* second) {
+        for(int ch=0; ch<NumChannels; ch++) {
+            history[ch][pos] = in[ch];
+            history[ch][pos + LENGTH] = in[ch];
+        }
+        pos = (pos + 1) % LENGTH;
+
+        const auto& filter = Halfband::get();
+        for(int ch=0; ch<NumChannels; ch++) {
+            // oldest first, x[LENGTH - 1] is the newest frame
+            const float* x = history[ch] + pos;
+            // the zero stuffed phase only sees the side taps, the other phase only the centre
+            float y = 0.f;
+            for(int j=0; j<Halfband::NUM_SIDE; j++) {
+                y += filter.side[j] * (x[Halfband::NUM_SIDE - 1 - j] + x[Halfband::NUM_SIDE + j]);
+            }
+            first[ch] = 2.f * y;
+            second[ch] = x[Halfband::NUM_SIDE];
+        }
+    }
+
+private:
+    float history[NumChannels][2 * LENGTH];
+    int pos = 0;
+};
+
+/// runs a stream down by 1, 2 or 4 and back up, cascading halfband stages
+template<int NumChannels>
+class Rate_Converter {
+public:
+    static constexpr int MAX_FACTOR = 4;
+
+    Rate_Converter() = default;
+    ~Rate_Converter() = default;
+
+    void prepare(const int f) {
+        factor = f >= 4 ? 4 : (f >= 2 ? 2 : 1);
+        reset();
+    }
+
+    void reset() {
+        firstDown.reset();
+        secondDown.reset();
+        firstUp.reset();
+        secondUp.reset();
+        std::fill(&upFrames[0][0], &upFrames[0][0] + MAX_FACTOR * NumChannels, 0.f);
+        phase = 0;
+        readIndex = 0;
+    }
+
+    int getFactor() const {
+        return factor;
+    }
+
+    /// full rate frame in (nullptr for silence), true once every factor frames with the low rate frame in out
+    bool down(const float* in, float* out) {
+        if(factor == 1) {
+            if(in != nullptr) std::copy(in, in + NumChannels, out);
+            else std::fill(out, out + NumChannels, 0.f);
+            return true;
+        }
+        firstDown.push(in);
+        phase = (phase + 1) % factor;
+        if(factor == 2) {
+            if(phase != 0) return false;
+            firstDown.compute(out);
+            return true;
+        }
+        if((phase & 1) != 0) return false;
+        float half[NumChannels];
+        firstDown.compute(half);
+        secondDown.push(half);
+        if(phase != 0) return false;
+        secondDown.compute(out);
+        return true;
+    }
+
+    /// low rate frame in, the next factor calls to next() read it back at the full rate
+    void up(const float* in) {
+        readIndex = 0;
+        if(factor == 1) {
+            std::copy(in, in + NumChannels, upFrames[0]);
+            return;
+        }
+        if(factor == 2) {
+            firstUp.process(in, upFrames[0], upFrames[1]);
+            return;
+        }
+        float half[2][NumChannels];
+        secondUp.process(in, half[0], half[1]);
+        firstUp.process(half[0], upFrames[0], upFrames[1]);
+        firstUp.process(half[1], upFrames[2], upFrames[3]);
+    }
+
+    /// full rate frame out
+    const float* next() {
+        const float* frame = upFrames[readIndex];
+        if(readIndex < factor - 1) readIndex++;
+        return frame;
+    }
+
+private:
+    int factor = 1;
+    int phase = 0;
+    int readIndex = 0;
+    Halfband_Decimator<NumChannels> firstDown; /// full rate to half
+    Halfband_Decimator<NumChannels> secondDown; /// half to quarter
+    Halfband_Interpolator<NumChannels> firstUp; /// half to full rate
+    Halfband_Interpolator<NumChannels> secondUp; /// quarter to half
+    float upFrames[MAX_FACTOR][NumChannels] = {{0.f}};
+};
+
+}
+
+#endif
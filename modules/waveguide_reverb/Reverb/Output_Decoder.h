@@ -0,0 +1,208 @@
+#ifndef COLIN_OUTPUT_DECODER_H
+#define COLIN_OUTPUT_DECODER_H
+#include <cmath>
+#include "juce_audio_basics/juce_audio_basics.h"
+#include "Frame.h"
+
+/*
+  ==============================================================================
+
+    Output_Decoder.h
+
+    gives each of the network's lines a direction and turns the lines
+    into a surround or ambisonic output, a speaker picks up the lines
+    pointing its way, an ambisonic output encodes every line as a plane
+    wave from its direction, the matrix is built once per layout and
+    applied with the decode kernel
+
+  ==============================================================================
+*/
+
+namespace Colin
+{
+
+class Output_Decoder {
+public:
+    static constexpr int MAX_OUTPUTS = NUM_CHANNELS; /// third order ambisonics
+    static constexpr int MAX_AMBISONIC_ORDER = 3;
+    static constexpr float DIRECTIVITY = 4.f;        /// power of each speaker's cardioid pickup, higher keeps neighbours apart
+    static constexpr float TOTAL_ENERGY = 16.f;      /// summed over the speakers, the same as the stereo fold down's two sides
+
+    /// 5.1, 7.1, 7.1.4 and first to third order ambisonics (ACN, SN3D)
+    static bool supports(const juce::AudioChannelSet& layout) {
+        const int order = layout.getAmbisonicOrder();
+        if(order >= 1) return order <= MAX_AMBISONIC_ORDER;
+        return layout == juce::AudioChannelSet::create5point1()
+            || layout == juce::AudioChannelSet::create7point1()
+            || layout == juce::AudioChannelSet::create7point1point4();
+    }
+
+    /// doesn't allocate, any layout supports() doesn't know leaves the decoder inactive
+    void build(const juce::AudioChannelSet& layout) {
+        *this = Output_Decoder();
+        if(!supports(layout)) return;
+        numOutputs = layout.size();
+        const int order = layout.getAmbisonicOrder();
+        if(order >= 1) buildAmbisonic();
+        else buildSpeakers(layout);
+    }
+
+    bool isActive() const {
+        return numOutputs > 0;
+    }
+
+    int getNumOutputs() const {
+        return numOutputs;
+    }
+
+    /// a column of MAX_OUTPUTS gains per line, the layout Kernel_Table::decode takes
+    const float* getMatrix() const {
+        return matrix;
+    }
+
+    /// an input in the decoder's own layout onto the network's two input sides,
+    /// by which side each speaker is on, or the omni and left-right components
+    void foldInputs(const juce::AudioBuffer<float>& buffer, const int startSample, const int numSamples, float* left, float* right) const {
+        std::fill(left, left + numSamples, 0.f);
+        std::fill(right, right + numSamples, 0.f);
+        for(int channel = 0; channel < numOutputs; channel++) {
+            const float toLeft = foldLeft[channel];
+            const float toRight = foldRight[channel];
+            if(toLeft == 0.f && toRight == 0.f) continue;
+            const float* in = buffer.getReadPointer(channel, startSample);
+            for(int i = 0; i < numSamples; i++) {
+                left[i] += in[i] * toLeft;
+                right[i] += in[i] * toRight;
+            }
+        }
+    }
+
+private:
+    alignas(64) float matrix[NUM_CHANNELS * MAX_OUTPUTS] = {0.f};
+    float foldLeft[MAX_OUTPUTS] = {0.f};
+    float foldRight[MAX_OUTPUTS] = {0.f};
+    int numOutputs = 0;
+
+    /// unit vector, x to the front, y to the left, z up
+    struct Direction {
+        float x = 1.f;
+        float y = 0.f;
+        float z = 0.f;
+    };
+
+    static Direction fromAngles(const float azimuthDegrees, const float elevationDegrees) {
+        const float azimuth = juce::degreesToRadians(azimuthDegrees);
+        const float elevation = juce::degreesToRadians(elevationDegrees);
+        return {std::cos(azimuth) * std::cos(elevation), std::sin(azimuth) * std::cos(elevation), std::sin(elevation)};
+    }
+
+    /// spread evenly over the sphere on a golden angle spiral, flat puts them all on the horizon
+    static Direction lineDirection(const int line, const bool flat) {
+        const float goldenAngle = juce::MathConstants<float>::pi * (3.f - std::sqrt(5.f));
+        const float z = 1.f - (2.f * static_cast<float>(line) + 1.f) / static_cast<float>(NUM_CHANNELS);
+        const float azimuth = goldenAngle * static_cast<float>(line);
+        const float radius = flat ? 1.f : std::sqrt(1.f - z * z);
+        return {radius * std::cos(azimuth), radius * std::sin(azimuth), flat ? 0.f : z};
+    }
+
+    /// false for the lfe and anything without a place in the supported layouts
+    static bool speakerDirection(const juce::AudioChannelSet::ChannelType type, Direction& direction) {
+        using Type = juce::AudioChannelSet::ChannelType;
+        switch(type) {
+            case Type::left:              direction = fromAngles(30.f, 0.f);    return true;
+            case Type::right:             direction = fromAngles(-30.f, 0.f);   return true;
+            case Type::centre:            direction = fromAngles(0.f, 0.f);     return true;
+            case Type::leftSurround:      direction = fromAngles(110.f, 0.f);   return true;
+            case Type::rightSurround:     direction = fromAngles(-110.f, 0.f);  return true;
+            case Type::leftSurroundSide:  direction = fromAngles(90.f, 0.f);    return true;
+            case Type::rightSurroundSide: direction = fromAngles(-90.f, 0.f);   return true;
+            case Type::leftSurroundRear:  direction = fromAngles(150.f, 0.f);   return true;
+            case Type::rightSurroundRear: direction = fromAngles(-150.f, 0.f);  return true;
+            case Type::topFrontLeft:      direction = fromAngles(45.f, 45.f);   return true;
+            case Type::topFrontRight:     direction = fromAngles(-45.f, 45.f);  return true;
+            case Type::topRearLeft:       direction = fromAngles(135.f, 45.f);  return true;
+            case Type::topRearRight:      direction = fromAngles(-135.f, 45.f); return true;
+            default:                                                            return false;
+        }
+    }
+
+    void buildSpeakers(const juce::AudioChannelSet& layout) {
+        Direction speakers[MAX_OUTPUTS];
+        bool placed[MAX_OUTPUTS] = {false};
+        int numSpeakers = 0;
+        bool height = false;
+        for(int channel = 0; channel < numOutputs; channel++) {
+            placed[channel] = speakerDirection(layout.getTypeOfChannel(channel), speakers[channel]);
+            if(!placed[channel]) continue;
+            numSpeakers++;
+            height = height || speakers[channel].z > 0.f;
+        }
+
+        for(int channel = 0; channel < numOutputs; channel++) {
+            if(!placed[channel]) continue; // the lfe gets no reverb
+            const Direction& speaker = speakers[channel];
+            float gains[NUM_CHANNELS];
+            float energy = 0.f;
+            for(int line = 0; line < NUM_CHANNELS; line++) {
+                const Direction d = lineDirection(line, !height);
+                const float cosine = speaker.x * d.x + speaker.y * d.y + speaker.z * d.z;
+                gains[line] = std::pow(0.5f + 0.5f * cosine, DIRECTIVITY);
+                energy += gains[line] * gains[line];
+            }
+            const float scale = std::sqrt(TOTAL_ENERGY / static_cast<float>(numSpeakers) / energy);
+            for(int line = 0; line < NUM_CHANNELS; line++) {
+                matrix[line * MAX_OUTPUTS + channel] = gains[line] * scale;
+            }
+            foldLeft[channel] = 0.5f + 0.5f * speaker.y;
+            foldRight[channel] = 0.5f - 0.5f * speaker.y;
+        }
+    }
+
+    void buildAmbisonic() {
+        // with every line at unit gain the omni channel would carry twice a stereo side's energy
+        const float gain = std::sqrt(0.5f);
+        for(int line = 0; line < NUM_CHANNELS; line++) {
+            float harmonics[MAX_OUTPUTS];
+            sphericalHarmonics(lineDirection(line, false), harmonics);
+            for(int channel = 0; channel < numOutputs; channel++) {
+                matrix[line * MAX_OUTPUTS + channel] = harmonics[channel] * gain;
+            }
+        }
+        // omni plus the left-right figure of eight, a pair of cardioids
+        foldLeft[0] = 0.5f;
+        foldRight[0] = 0.5f;
+        foldLeft[1] = 0.5f;
+        foldRight[1] = -0.5f;
+    }
+
+    /// real spherical harmonics up to third order, ACN channel order with SN3D normalisation
+    static void sphericalHarmonics(const Direction& d, float* y) {
+        const float x = d.x;
+        const float yy = d.y;
+        const float z = d.z;
+        const float sqrt3 = std::sqrt(3.f);
+        const float sqrt15 = std::sqrt(15.f);
+        const float sqrt5_8 = std::sqrt(5.f / 8.f);
+        const float sqrt3_8 = std::sqrt(3.f / 8.f);
+        y[0] = 1.f;
+        y[1] = yy;
+        y[2] = z;
+        y[3] = x;
+        y[4] = sqrt3 * x * yy;
+        y[5] = sqrt3 * yy * z;
+        y[6] = 0.5f * (3.f * z * z - 1.f);
+        y[7] = sqrt3 * x * z;
+        y[8] = 0.5f * sqrt3 * (x * x - yy * yy);
+        y[9] = sqrt5_8 * yy * (3.f * x * x - yy * yy);
+        y[10] = sqrt15 * x * yy * z;
+        y[11] = sqrt3_8 * yy * (5.f * z * z - 1.f);
+        y[12] = 0.5f * z * (5.f * z * z - 3.f);
+        y[13] = sqrt3_8 * x * (5.f * z * z - 1.f);
+        y[14] = 0.5f * sqrt15 * z * (x * x - yy * yy);
+        y[15] = sqrt5_8 * x * (x * x - 3.f * yy * yy);
+    }
+};
+
+}
+
+#endif
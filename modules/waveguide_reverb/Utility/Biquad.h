@@ -92,6 +92,9 @@ public:
         z2 = sample * b2 - a2 * out;
         return out;
     }
+    void reset() {
+        z1 = z2 = 0.0;
+    }
     void calcBiquad()
     {
         double norm;
@@ -0,0 +1,133 @@
+#ifndef COLIN_BUFFER_POOL_H
+#define COLIN_BUFFER_POOL_H
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "juce_core/juce_core.h"
+
+/*
+  ==============================================================================
+
+    Buffer_Pool.h
+
+    one per sample type per process (juce::SharedResourcePointer), released
+    instances park their delay line storage here and the next prepare takes
+    it back, already touched, instead of going to the allocator
+
+  ==============================================================================
+*/
+
+namespace Colin
+{
+
+template<typename T>
+class Buffer_Pool {
+public:
+    static constexpr size_t DEFAULT_LIMIT = 16u << 20; /// bytes kept for reuse, the rest goes back to the system
+
+    Buffer_Pool() = default;
+    ~Buffer_Pool() = default;
+
+    void setLimit(const size_t bytes) {
+        const juce::ScopedLock lock(poolLock);
+        limit = bytes;
+        trim();
+    }
+
+    size_t getLimit() const {
+        const juce::ScopedLock lock(poolLock);
+        return limit;
+    }
+
+    /// bytes parked in the pool right now
+    size_t getPooledBytes() const {
+        const juce::ScopedLock lock(poolLock);
+        return pooledBytes;
+    }
+
+    /// acquires served from the pool, and those that had to allocate
+    uint64_t getWarmCount() const {
+        const juce::ScopedLock lock(poolLock);
+        return warm;
+    }
+
+    uint64_t getColdCount() const {
+        const juce::ScopedLock lock(poolLock);
+        return cold;
+    }
+
+    /// never on the audio thread, an empty vector with room for at least capacity elements,
+    /// the smallest pooled one that fits without wasting more than half of it
+    std::vector<T> acquire(const size_t capacity) {
+        std::vector<T> buffer;
+        {
+            const juce::ScopedLock lock(poolLock);
+            size_t best = buffers.size();
+            for(size_t i = 0; i < buffers.size(); i++) {
+                const size_t c = buffers[i].capacity();
+                if(c >= capacity && c <= capacity * 2 && (best == buffers.size() || c < buffers[best].capacity())) {
+                    best = i;
+                }
+            }
+            if(best < buffers.size()) {
+                buffer.swap(buffers[best]);
+                buffers.erase(buffers.begin() + static_cast<std::ptrdiff_t>(best));
+                pooledBytes -= buffer.capacity() * sizeof(T);
+                warm++;
+                return buffer;
+            }
+            cold++;
+        }
+        buffer.reserve(capacity);
+        return buffer;
+    }
+
+    /// never on the audio thread, keeps the storage if it fits under the limit,
+    /// dropping the oldest parked buffers to make room
+    void release(std::vector<T>&& buffer) {
+        buffer.clear();
+        const size_t bytes = buffer.capacity() * sizeof(T);
+        if(bytes == 0) return;
+        std::vector<T> dropped;
+        {
+            const juce::ScopedLock lock(poolLock);
+            if(bytes > limit) {
+                dropped.swap(buffer);
+            }
+            else {
+                buffers.push_back(std::move(buffer));
+                pooledBytes += bytes;
+                trim();
+            }
+        }
+    }
+
+    /// gives everything back to the system
+    void clear() {
+        const juce::ScopedLock lock(poolLock);
+        buffers.clear();
+        buffers.shrink_to_fit();
+        pooledBytes = 0;
+    }
+
+private:
+    void trim() {
+        size_t drop = 0;
+        while(pooledBytes > limit && drop < buffers.size()) {
+            pooledBytes -= buffers[drop].capacity() * sizeof(T);
+            drop++;
+        }
+        buffers.erase(buffers.begin(), buffers.begin() + static_cast<std::ptrdiff_t>(drop));
+    }
+
+    juce::CriticalSection poolLock;
+    std::vector<std::vector<T>> buffers; /// oldest first
+    size_t pooledBytes = 0;
+    size_t limit = DEFAULT_LIMIT;
+    uint64_t warm = 0;
+    uint64_t cold = 0;
+};
+
+}
+
+#endif
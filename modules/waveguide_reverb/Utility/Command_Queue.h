@@ -0,0 +1,57 @@
+#ifndef COLIN_COMMAND_QUEUE_H
+#define COLIN_COMMAND_QUEUE_H
+#include <array>
+#include "juce_core/juce_core.h"
+
+/*
+  ==============================================================================
+
+    Command_Queue.h
+
+    single producer / single consumer fifo of trivially copyable commands,
+    never allocates or locks after construction
+
+  ==============================================================================
+*/
+
+namespace Colin
+{
+
+template <typename T, int Capacity>
+class Command_Queue {
+protected:
+    juce::AbstractFifo fifo {Capacity};
+    std::array<T, Capacity> commands {};
+
+public:
+    Command_Queue() = default;
+    ~Command_Queue() = default;
+
+    /// producer thread only, returns false if the queue is full
+    bool push(const T& command) {
+        int start1, size1, start2, size2;
+        fifo.prepareToWrite(1, start1, size1, start2, size2);
+        if(size1 + size2 < 1) return false;
+        commands[static_cast<size_t>(size1 > 0 ? start1 : start2)] = command;
+        fifo.finishedWrite(1);
+        return true;
+    }
+
+    /// consumer thread only, returns false if there is nothing to read
+    bool pop(T& command) {
+        int start1, size1, start2, size2;
+        fifo.prepareToRead(1, start1, size1, start2, size2);
+        if(size1 + size2 < 1) return false;
+        command = commands[static_cast<size_t>(size1 > 0 ? start1 : start2)];
+        fifo.finishedRead(1);
+        return true;
+    }
+
+    bool isEmpty() const {
+        return fifo.getNumReady() == 0;
+    }
+};
+
+}
+
+#endif
@@ -0,0 +1,70 @@
+#ifndef COLIN_DIRTY_MASK_H
+#define COLIN_DIRTY_MASK_H
+#include <atomic>
+#include <cstdint>
+#include "juce_core/juce_core.h"
+
+/*
+  ==============================================================================
+
+    Dirty_Mask.h
+
+    lock-free parameter cache, writers store a value and set its bit,
+    the audio thread takes the whole mask at once and only applies what changed
+
+  ==============================================================================
+*/
+
+namespace Colin
+{
+
+template <size_t NumParameters>
+class Dirty_Mask {
+    static_assert(NumParameters <= 32, "Dirty_Mask holds at most 32 parameters");
+
+protected:
+    std::atomic<uint32_t> dirty {0};
+    std::atomic<float> values[NumParameters];
+
+public:
+    Dirty_Mask() {
+        for(size_t i=0; i<NumParameters; i++) {
+            values[i].store(0.f, std::memory_order_relaxed);
+        }
+    }
+    ~Dirty_Mask() = default;
+
+    /// any thread, value is visible before its bit is
+    void store(const size_t index, const float value) {
+        jassert(index < NumParameters);
+        values[index].store(value, std::memory_order_relaxed);
+        dirty.fetch_or(1u << index, std::memory_order_release);
+    }
+
+    /// forces every parameter to be applied on the next takeChanged()
+    void markAll() {
+        dirty.store(allBits(), std::memory_order_release);
+    }
+
+    /// audio thread, returns the set of changed parameters and clears it
+    uint32_t takeChanged() {
+        if(dirty.load(std::memory_order_relaxed) == 0) return 0;
+        return dirty.exchange(0, std::memory_order_acquire);
+    }
+
+    float get(const size_t index) const {
+        return values[index].load(std::memory_order_relaxed);
+    }
+
+    static constexpr uint32_t bit(const size_t index) {
+        return 1u << index;
+    }
+
+    static constexpr uint32_t allBits() {
+        return NumParameters == 32 ? 0xffffffffu : (1u << NumParameters) - 1u;
+    }
+};
+
+}
+
+#endif
@@ -0,0 +1,77 @@
+#ifndef COLIN_HEALTH_MONITOR_H
+#define COLIN_HEALTH_MONITOR_H
+#include <atomic>
+#include <cstdint>
+#include "Sample_Storage.h"
+
+/*
+  ==============================================================================
+
+    Health_Monitor.h
+
+    once a block the samples the feedback lines and strings just wrote are
+    scanned for nan, inf and subnormals, lines holding a non finite value
+    are cleared on their own and subnormals are flushed to zero, this only
+    keeps the counts
+
+  ==============================================================================
+*/
+
+namespace Colin
+{
+
+struct Health_Report {
+    uint64_t blocksChecked = 0;
+    uint64_t nonFiniteBlocks = 0; /// blocks where a line held nan or inf
+    uint64_t subnormalBlocks = 0; /// blocks where a line held subnormals
+    uint64_t linesCleared = 0;
+};
+
+class Health_Monitor {
+public:
+    /// any thread
+    void setEnabled(const bool shouldCheck) {
+        enabled.store(shouldCheck, std::memory_order_relaxed);
+    }
+
+    bool isEnabled() const {
+        return enabled.load(std::memory_order_relaxed);
+    }
+
+    /// audio thread, flags is what the block's scans found
+    void record(const uint32_t flags, const int linesCleared) {
+        blocks.fetch_add(1, std::memory_order_relaxed);
+        if(flags == Healthy) return;
+        if(flags & Non_Finite) nonFinite.fetch_add(1, std::memory_order_relaxed);
+        if(flags & Subnormal) subnormal.fetch_add(1, std::memory_order_relaxed);
+        cleared.fetch_add(static_cast<uint64_t>(linesCleared), std::memory_order_relaxed);
+    }
+
+    /// any thread
+    Health_Report getReport() const {
+        Health_Report report;
+        report.blocksChecked = blocks.load(std::memory_order_relaxed);
+        report.nonFiniteBlocks = nonFinite.load(std::memory_order_relaxed);
+        report.subnormalBlocks = subnormal.load(std::memory_order_relaxed);
+        report.linesCleared = cleared.load(std::memory_order_relaxed);
+        return report;
+    }
+
+    void resetCounts() {
+        blocks.store(0, std::memory_order_relaxed);
+        nonFinite.store(0, std::memory_order_relaxed);
+        subnormal.store(0, std::memory_order_relaxed);
+        cleared.store(0, std::memory_order_relaxed);
+    }
+
+private:
+    std::atomic<bool> enabled {true};
+    std::atomic<uint64_t> blocks {0};
+    std::atomic<uint64_t> nonFinite {0};
+    std::atomic<uint64_t> subnormal {0};
+    std::atomic<uint64_t> cleared {0};
+};
+
+}
+
+#endif
@@ -0,0 +1,252 @@
+#ifndef COLIN_KERNELS_H
+#define COLIN_KERNELS_H
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <vector>
+#include "juce_core/juce_core.h"
+#include "../Reverb/Frame.h"
+
+/*
+  ==============================================================================
+
+    Kernels.h
+
+    the per sample inner loops written once and compiled again for every
+    instruction set the build can target, the best one the cpu supports
+    is picked the first time a table is asked for
+
+    the bodies are plain loops the compiler vectorises, each level only
+    changes the target they are inlined into, gcc and clang on x86 get
+    avx2 and avx-512 versions next to the baseline (sse2 on x86-64, neon
+    on arm64), other compilers only the baseline
+
+  ==============================================================================
+*/
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#define COLIN_KERNEL_INLINE __forceinline
+#else
+#define COLIN_KERNEL_INLINE inline __attribute__((always_inline))
+#endif
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define COLIN_KERNELS_X86_TARGETS 1
+#else
+#define COLIN_KERNELS_X86_TARGETS 0
+#endif
+
+namespace Colin
+{
+
+/// instruction set a kernel table was compiled for
+enum class Cpu_Level {
+    Baseline = 0, /// whatever the build targets, sse2 on x86-64, neon on arm64
+    AVX2,
+    AVX512
+};
+
+/// sixteen parallel biquads on one input, laid out so the sections vectorise across modes
+struct Modal_Bank {
+    static constexpr int NUM_MODES = 16;
+    alignas(64) double b0[NUM_MODES] = {0};
+    alignas(64) double b1[NUM_MODES] = {0};
+    alignas(64) double b2[NUM_MODES] = {0};
+    alignas(64) double a1[NUM_MODES] = {0};
+    alignas(64) double a2[NUM_MODES] = {0};
+    alignas(64) double z1[NUM_MODES] = {0};
+    alignas(64) double z2[NUM_MODES] = {0};
+
+    /// a0 normalised out, same as Biquad_Filter::setCoefficients
+    void setCoefficients(const int mode, const double nb0, const double nb1, const double nb2, const double na1, const double na2) {
+        b0[mode] = nb0;
+        b1[mode] = nb1;
+        b2[mode] = nb2;
+        a1[mode] = na1;
+        a2[mode] = na2;
+    }
+
+    void reset() {
+        for(int i = 0; i < NUM_MODES; i++) {
+            z1[i] = 0.0;
+            z2[i] = 0.0;
+        }
+    }
+};
+
+struct Kernel_Table {
+    Cpu_Level level = Cpu_Level::Baseline;
+    const char* name = "";
+    /// 16 channels, in and out may alias
+    void (*hadamard)(const float* in, float* out) = nullptr;
+    /// out = input + householder(output) * decay * lfo, the feedback network's write
+    void (*feedback)(const data& input, const data& output, float decay, const float* lfo, data& out) = nullptr;
+    /// the summed output of every mode
+    float (*modalBank)(Modal_Bank& bank, float x) = nullptr;
+    /// out = softClip(wet * gain * wetCoeff + dry * dryCoeff) for one channel, out may alias dry
+    void (*outputStage)(const float* wet, const float* dry, float* out, int numSamples, float gain, float wetCoeff, float dryCoeff) = nullptr;
+    /// numFrames frames of 16 channels through a matrix with a column of 16 outputs per channel,
+    /// only the first numOutputs are written
+    void (*decode)(const float* frames, const float* matrix, float* const* out, int numOutputs, int numFrames) = nullptr;
+};
+
+namespace Kernels
+{
+    constexpr int N = 16;
+
+    COLIN_KERNEL_INLINE void hadamard(const float* in, float* out) {
+        float r[N];
+        for(int i = 0; i < N; i++) r[i] = in[i];
+        // the recursive sum/difference unrolled, smallest halves first
+        for(int h = 1; h < N; h *= 2) {
+            for(int i = 0; i < N; i += 2 * h) {
+                for(int j = i; j < i + h; j++) {
+                    const float a = r[j];
+                    const float b = r[j + h];
+                    r[j] = a + b;
+                    r[j + h] = a - b;
+                }
+            }
+        }
+        for(int i = 0; i < N; i++) out[i] = r[i] * 0.25f; // sqrt(1 / 16)
+    }
+
+    /// the frame expression evaluated in one loop, out may alias input but not output
+    COLIN_KERNEL_INLINE void feedback(const data& input, const data& output, const float decay, const float* lfo, data& out) {
+        out = input + householder(output) * decay * lanes(lfo);
+    }
+
+    COLIN_KERNEL_INLINE float modalBank(Modal_Bank& bank, const float x) {
+        const double in = x;
+        float y[Modal_Bank::NUM_MODES];
+        for(int i = 0; i < Modal_Bank::NUM_MODES; i++) {
+            const float out = static_cast<float>(in * bank.b0[i] + bank.z1[i]);
+            bank.z1[i] = in * bank.b1[i] + bank.z2[i] - bank.a1[i] * out;
+            bank.z2[i] = in * bank.b2[i] - bank.a2[i] * out;
+            y[i] = out;
+        }
+        float sum = 0.f;
+        for(int i = 0; i < Modal_Bank::NUM_MODES; i++) sum += y[i];
+        return sum;
+    }
+
+    /// (2 / pi) * atan(x), cephes atanf without branches so it vectorises, within 2 ulp of atanf
+    COLIN_KERNEL_INLINE float softClip(const float x) {
+        const float pi = 3.14159265358979f;
+        const float ax = x < 0.f ? -x : x;
+        const bool big = ax > 2.414213562373095f;   // tan(3 pi / 8)
+        const bool mid = ax > 0.4142135623730950f;  // tan(pi / 8)
+        const float z = big ? -1.f / ax : (mid ? (ax - 1.f) / (ax + 1.f) : ax);
+        const float offset = big ? 0.5f * pi : (mid ? 0.25f * pi : 0.f);
+        const float zz = z * z;
+        const float p = (((8.05374449538e-2f * zz - 1.38776856032e-1f) * zz + 1.99777106478e-1f) * zz - 3.33329491539e-1f) * zz * z + z;
+        const float a = offset + p;
+        return (2.f / pi) * (x < 0.f ? -a : a);
+    }
+
+    COLIN_KERNEL_INLINE void outputStage(const float* wet, const float* dry, float* out, const int numSamples, const float gain, const float wetCoeff, const float dryCoeff) {
+        for(int i = 0; i < numSamples; i++) {
+            out[i] = softClip((wet[i] * gain) * wetCoeff + dry[i] * dryCoeff);
+        }
+    }
+
+    COLIN_KERNEL_INLINE void decode(const float* frames, const float* matrix, float* const* out, const int numOutputs, const int numFrames) {
+        for(int i = 0; i < numFrames; i++) {
+            // one column at a time so the outputs vectorise, no reduction across lanes
+            float sum[N] = {0.f};
+            const float* frame = frames + i * N;
+            for(int k = 0; k < N; k++) {
+                const float x = frame[k];
+                const float* column = matrix + k * N;
+                for(int c = 0; c < N; c++) sum[c] += column[c] * x;
+            }
+            for(int c = 0; c < numOutputs; c++) out[c][i] = sum[c];
+        }
+    }
+}
+
+/// stamps out one table whose entries are the kernels inlined into functions built for target
+#define COLIN_KERNEL_LEVEL(Struct, levelValue, levelName, target) \
+    struct Struct { \
+        target static void hadamard(const float* in, float* out) { Kernels::hadamard(in, out); } \
+        target static void feedback(const data& input, const data& output, float decay, const float* lfo, data& out) { Kernels::feedback(input, output, decay, lfo, out); } \
+        target static float modalBank(Modal_Bank& bank, float x) { return Kernels::modalBank(bank, x); } \
+        target static void outputStage(const float* wet, const float* dry, float* out, int n, float gain, float wetCoeff, float dryCoeff) { Kernels::outputStage(wet, dry, out, n, gain, wetCoeff, dryCoeff); } \
+        target static void decode(const float* frames, const float* matrix, float* const* out, int numOutputs, int n) { Kernels::decode(frames, matrix, out, numOutputs, n); } \
+        static const Kernel_Table& table() { \
+            static const Kernel_Table t {levelValue, levelName, &hadamard, &feedback, &modalBank, &outputStage, &decode}; \
+            return t; \
+        } \
+    };
+
+#if defined(__aarch64__) || defined(_M_ARM64)
+COLIN_KERNEL_LEVEL(Baseline_Kernels, Cpu_Level::Baseline, "NEON", )
+#elif defined(__x86_64__) || defined(_M_X64)
+COLIN_KERNEL_LEVEL(Baseline_Kernels, Cpu_Level::Baseline, "SSE2", )
+#else
+COLIN_KERNEL_LEVEL(Baseline_Kernels, Cpu_Level::Baseline, "Scalar", )
+#endif
+
+#if COLIN_KERNELS_X86_TARGETS
+COLIN_KERNEL_LEVEL(AVX2_Kernels, Cpu_Level::AVX2, "AVX2", __attribute__((target("avx2,fma"))))
+COLIN_KERNEL_LEVEL(AVX512_Kernels, Cpu_Level::AVX512, "AVX-512", __attribute__((target("avx512f,avx512dq,avx512vl,avx2,fma"))))
+#endif
+
+#undef COLIN_KERNEL_LEVEL
+
+/// which table the engine uses, objects take the pointer when they are built
+class Kernel_Dispatch {
+public:
+    /// the table in use, the best the cpu supports unless forced
+    static const Kernel_Table& get() {
+        return *current().load(std::memory_order_acquire);
+    }
+
+    /// levels this build has and this cpu runs
+    static std::vector<Cpu_Level> getAvailable() {
+        std::vector<Cpu_Level> levels {Cpu_Level::Baseline};
+#if COLIN_KERNELS_X86_TARGETS
+        if(juce::SystemStats::hasAVX2() && juce::SystemStats::hasFMA3()) levels.push_back(Cpu_Level::AVX2);
+        // the table is built for f, dq and vl together, f alone isn't enough to run it
+        const bool avx512 = juce::SystemStats::hasAVX512F() && juce::SystemStats::hasAVX512DQ() && juce::SystemStats::hasAVX512VL();
+        if(avx512 && juce::SystemStats::hasAVX2() && juce::SystemStats::hasFMA3()) levels.push_back(Cpu_Level::AVX512);
+#endif
+        return levels;
+    }
+
+    static const Kernel_Table& getTable(const Cpu_Level level) {
+#if COLIN_KERNELS_X86_TARGETS
+        if(level == Cpu_Level::AVX512) return AVX512_Kernels::table();
+        if(level == Cpu_Level::AVX2) return AVX2_Kernels::table();
+#endif
+        juce::ignoreUnused(level);
+        return Baseline_Kernels::table();
+    }
+
+    /// tests and benchmarks, only objects built afterwards pick it up, false if the cpu can't run it
+    static bool force(const Cpu_Level level) {
+        const auto available = getAvailable();
+        if(std::find(available.begin(), available.end(), level) == available.end()) return false;
+        current().store(&getTable(level), std::memory_order_release);
+        return true;
+    }
+
+    /// back to the best level
+    static void reset() {
+        current().store(&best(), std::memory_order_release);
+    }
+
+private:
+    static const Kernel_Table& best() {
+        return getTable(getAvailable().back());
+    }
+
+    static std::atomic<const Kernel_Table*>& current() {
+        static std::atomic<const Kernel_Table*> table {&best()};
+        return table;
+    }
+};
+
+}
+
+#endif
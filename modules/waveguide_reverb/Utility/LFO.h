@@ -30,7 +30,7 @@ private:
     bool playing = false;
     
     float depth = 50.f; // 1 to 100 value
-    float rate; // 0.1 to 10 hz
+    float rate = 0.f; // 0.1 to 10 hz
     
 public:
     LFO() = default;
@@ -45,6 +45,11 @@ public:
             revsaw.setSampleRate(sampleRate);
             triangle.setSampleRate(sampleRate);
             this->sampleRate = sampleRate;
+            // the oscillators stop and keep their old increment when the rate changes
+            const float r = rate;
+            rate = 0.f;
+            setRate(r);
+            if(playing) start();
         }
     }
     
@@ -94,6 +99,13 @@ public:
         playing = false;
     }
     
+    /// back to the start of the cycle, still playing if it was
+    void reset() {
+        const bool wasPlaying = playing;
+        stop();
+        if(wasPlaying) start();
+    }
+    
     float getValue() {
         // scale oscillator ouputs to be values between 0 and 1, then adjust based on depth
         float sample = 0;
@@ -0,0 +1,154 @@
+#ifndef COLIN_LOAD_GOVERNOR_H
+#define COLIN_LOAD_GOVERNOR_H
+#include <atomic>
+#include <cstdint>
+#include "juce_audio_basics/juce_audio_basics.h"
+
+/*
+  ==============================================================================
+
+    Load_Governor.h
+
+    times every block against its deadline, and when the load stays near
+    the threshold steps the engine down a quality tier, it steps back up
+    once the load has stayed well below the threshold for a while, the
+    engine crossfades each change so a tier switch never clicks
+
+  ==============================================================================
+*/
+
+namespace Colin
+{
+
+/// each tier keeps the savings of the ones before it
+enum class Quality_Tier {
+    Full = 0,
+    Short_Diffusion,        /// the diffuser drops its two longest steps
+    Fewer_Strings,          /// half the string voices, the rest ring out
+    Control_Rate_Modulation /// the feedback lfos are worked out every few samples and ramped
+};
+
+inline const char* getQualityTierName(const Quality_Tier tier) {
+    switch(tier) {
+        case Quality_Tier::Short_Diffusion:         return "Short Diffusion";
+        case Quality_Tier::Fewer_Strings:           return "Fewer Strings";
+        case Quality_Tier::Control_Rate_Modulation: return "Control Rate Modulation";
+        case Quality_Tier::Full:
+        default:                                    return "Full";
+    }
+}
+
+class Load_Governor {
+public:
+    static constexpr Quality_Tier LOWEST_TIER = Quality_Tier::Control_Rate_Modulation;
+    static constexpr float RECOVERY_RATIO = 0.6f;  /// of the threshold, the load has to fall below this to step up
+    static constexpr double STEP_DOWN_MS = 100.0;  /// over the threshold this long before each step down
+    static constexpr double STEP_UP_MS = 3000.0;   /// under the recovery load this long before each step up
+
+    /// audio stopped, forgets the measured load and goes back to Full
+    void prepare(const double fs, const int maxBlockSize) {
+        measurer.reset(fs, maxBlockSize);
+        stepDownSamples = static_cast<int>(fs * STEP_DOWN_MS * 0.001);
+        stepUpSamples = static_cast<int>(fs * STEP_UP_MS * 0.001);
+        reset();
+    }
+
+    /// any thread, a disabled governor holds the engine at Full
+    void setEnabled(const bool shouldGovern) {
+        enabled.store(shouldGovern, std::memory_order_relaxed);
+    }
+
+    bool isEnabled() const {
+        return enabled.load(std::memory_order_relaxed);
+    }
+
+    /// any thread, the share of each block's deadline the engine may use, 0 to 1
+    void setThreshold(const float proportion) {
+        threshold.store(proportion, std::memory_order_relaxed);
+    }
+
+    /// audio thread, around everything the block costs
+    void begin() {
+        running = isEnabled();
+        if(running) start = juce::Time::getMillisecondCounterHiRes();
+    }
+
+    void end(const int numSamples) {
+        if(!running) {
+            if(getTier() != Quality_Tier::Full) setTier(0);
+            return;
+        }
+        measurer.registerRenderTime(juce::Time::getMillisecondCounterHiRes() - start, numSamples);
+        update(measurer.getLoadAsProportion(), numSamples);
+    }
+
+    /// audio thread, load is the smoothed share of the deadline the last blocks used
+    void update(const double load, const int numSamples) {
+        const float limit = threshold.load(std::memory_order_relaxed);
+        const int current = static_cast<int>(getTier());
+        if(load > limit) {
+            underSamples = 0;
+            overSamples += numSamples;
+            if(overSamples >= stepDownSamples && current < static_cast<int>(LOWEST_TIER)) {
+                setTier(current + 1);
+            }
+        }
+        else if(load < limit * RECOVERY_RATIO) {
+            overSamples = 0;
+            underSamples += numSamples;
+            if(underSamples >= stepUpSamples && current > 0) {
+                setTier(current - 1);
+            }
+        }
+        else {
+            // in between, hold the tier
+            overSamples = 0;
+            underSamples = 0;
+        }
+    }
+
+    /// any thread, e.g. polled by the GUI
+    Quality_Tier getTier() const {
+        return static_cast<Quality_Tier>(tier.load(std::memory_order_relaxed));
+    }
+
+    double getLoad() const {
+        return measurer.getLoadAsProportion();
+    }
+
+    /// tier changes since the last prepare
+    uint32_t getTierChanges() const {
+        return changes.load(std::memory_order_relaxed);
+    }
+
+private:
+    juce::AudioProcessLoadMeasurer measurer;
+    std::atomic<bool> enabled {false};
+    std::atomic<float> threshold {0.7f};
+    std::atomic<int> tier {0};
+    std::atomic<uint32_t> changes {0};
+    bool running = false;
+    double start = 0.0;
+    int overSamples = 0;
+    int underSamples = 0;
+    int stepDownSamples = 4410;
+    int stepUpSamples = 132300;
+
+    void setTier(const int newTier) {
+        tier.store(newTier, std::memory_order_relaxed);
+        changes.fetch_add(1, std::memory_order_relaxed);
+        overSamples = 0;
+        underSamples = 0;
+    }
+
+    void reset() {
+        tier.store(0, std::memory_order_relaxed);
+        changes.store(0, std::memory_order_relaxed);
+        overSamples = 0;
+        underSamples = 0;
+    }
+};
+
+}
+
+#endif
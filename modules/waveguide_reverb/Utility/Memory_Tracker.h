@@ -0,0 +1,71 @@
+#ifndef COLIN_MEMORY_TRACKER_H
+#define COLIN_MEMORY_TRACKER_H
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+/*
+  ==============================================================================
+
+    Memory_Tracker.h
+
+    one per process (juce::SharedResourcePointer), every instance reports
+    what it holds after preparing so a session's total can be watched and capped
+
+  ==============================================================================
+*/
+
+namespace Colin
+{
+
+/// bytes held by one engine, by component
+struct Memory_Usage {
+    size_t strings = 0;   /// waveguide lines and body filters
+    size_t diffusion = 0; /// diffuser and the high band allpasses
+    size_t feedback = 0;  /// feedback delay network and its lfos
+    size_t multirate = 0; /// crossover and rate converters
+    size_t frozen = 0;    /// convolution scratch and the loaded response
+    size_t engine = 0;    /// everything else
+
+    size_t total() const {
+        return strings + diffusion + feedback + multirate + frozen + engine;
+    }
+};
+
+class Memory_Tracker {
+public:
+    Memory_Tracker() = default;
+    ~Memory_Tracker() = default;
+
+    /// 0 means no limit
+    void setLimit(const size_t bytes) {
+        limit.store(bytes, std::memory_order_relaxed);
+    }
+
+    size_t getLimit() const {
+        return limit.load(std::memory_order_relaxed);
+    }
+
+    size_t getTotal() const {
+        return static_cast<size_t>(total.load(std::memory_order_relaxed));
+    }
+
+    /// swaps an instance's previous report for its current one
+    void update(const size_t previous, const size_t current) {
+        total.fetch_add(static_cast<int64_t>(current) - static_cast<int64_t>(previous), std::memory_order_relaxed);
+    }
+
+    /// whether an instance reporting previous could grow to current and stay within the limit
+    bool fits(const size_t previous, const size_t current) const {
+        const size_t l = getLimit();
+        return l == 0 || getTotal() - previous + current <= l;
+    }
+
+private:
+    std::atomic<int64_t> total {0};
+    std::atomic<size_t> limit {0};
+};
+
+}
+
+#endif
@@ -0,0 +1,190 @@
+#ifndef COLIN_PAGE_RESIDENCY_H
+#define COLIN_PAGE_RESIDENCY_H
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include "juce_core/juce_core.h"
+#if JUCE_LINUX || JUCE_MAC || JUCE_BSD || JUCE_ANDROID
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <unistd.h>
+#define COLIN_HAS_MMAN 1
+#else
+#define COLIN_HAS_MMAN 0
+#endif
+
+/*
+  ==============================================================================
+
+    Page_Residency.h
+
+    freshly allocated delay memory only gets real pages the first time it
+    is written, so the first blocks after a prepare fault on the audio
+    thread, these helpers map (and optionally pin) it ahead of time and
+    count the faults the audio thread still takes
+
+  ==============================================================================
+*/
+
+namespace Colin
+{
+
+/// bytes a prefault pass touched and managed to lock
+struct Residency_Bytes {
+    size_t touched = 0;
+    size_t locked = 0;
+    bool lockFailed = false;
+
+    Residency_Bytes& operator+=(const Residency_Bytes& other) {
+        touched += other.touched;
+        locked += other.locked;
+        lockFailed = lockFailed || other.lockFailed;
+        return *this;
+    }
+};
+
+/// what WaveVerb reports, the fault counts are the audio thread's while monitoring is on
+struct Residency_Report {
+    Residency_Bytes bytes;
+    uint64_t audioMinorFaults = 0; /// page mapped in without disk, still a kernel round trip
+    uint64_t audioMajorFaults = 0; /// had to wait for the disk or swap
+    uint64_t faultingBlocks = 0;
+    uint64_t monitoredBlocks = 0;
+    size_t peakResidentBytes = 0; /// whole process, a rough measure of memory pressure
+};
+
+struct Page_Residency {
+    struct Fault_Counts {
+        uint64_t minor = 0;
+        uint64_t major = 0;
+    };
+
+    /// hints the kernel to map the range in, the pages are only guaranteed once written
+    static void advise(const void* data, const size_t bytes) {
+#if COLIN_HAS_MMAN
+        if(bytes == 0) return;
+        uintptr_t start = 0;
+        size_t length = 0;
+        pageRange(data, bytes, start, length);
+        madvise(reinterpret_cast<void*>(start), length, MADV_WILLNEED);
+#else
+        juce::ignoreUnused(data, bytes);
+#endif
+    }
+
+    /// pins the pages, fails quietly where RLIMIT_MEMLOCK or the platform says no
+    static bool lock(const void* data, const size_t bytes) {
+#if COLIN_HAS_MMAN
+        return bytes == 0 || mlock(data, bytes) == 0;
+#else
+        juce::ignoreUnused(data, bytes);
+        return false;
+#endif
+    }
+
+    static void unlock(const void* data, const size_t bytes) {
+#if COLIN_HAS_MMAN
+        if(bytes > 0) munlock(data, bytes);
+#else
+        juce::ignoreUnused(data, bytes);
+#endif
+    }
+
+    /// faults taken by the calling thread so far (the whole process on macOS), zeros where unsupported
+    static Fault_Counts threadFaults() {
+        Fault_Counts counts;
+#if COLIN_HAS_MMAN
+        rusage usage {};
+       #if defined(RUSAGE_THREAD)
+        const int who = RUSAGE_THREAD;
+       #else
+        const int who = RUSAGE_SELF;
+       #endif
+        if(getrusage(who, &usage) == 0) {
+            counts.minor = static_cast<uint64_t>(usage.ru_minflt);
+            counts.major = static_cast<uint64_t>(usage.ru_majflt);
+        }
+#endif
+        return counts;
+    }
+
+    static size_t peakResidentBytes() {
+#if COLIN_HAS_MMAN
+        rusage usage {};
+        if(getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+       #if JUCE_MAC
+        return static_cast<size_t>(usage.ru_maxrss); // bytes on macOS
+       #else
+        return static_cast<size_t>(usage.ru_maxrss) * 1024; // kilobytes elsewhere
+       #endif
+#else
+        return 0;
+#endif
+    }
+
+private:
+    static void pageRange(const void* data, const size_t bytes, uintptr_t& start, size_t& length) {
+#if COLIN_HAS_MMAN
+        const uintptr_t page = static_cast<uintptr_t>(sysconf(_SC_PAGESIZE));
+#else
+        const uintptr_t page = 4096;
+#endif
+        const uintptr_t begin = reinterpret_cast<uintptr_t>(data);
+        start = begin & ~(page - 1);
+        length = static_cast<size_t>(begin + bytes - start);
+    }
+};
+
+/// audio thread, counts the faults taken inside each block while switched on
+class Fault_Monitor {
+public:
+    /// any thread
+    void setEnabled(const bool shouldMonitor) {
+        enabled.store(shouldMonitor, std::memory_order_relaxed);
+    }
+
+    void begin() {
+        running = enabled.load(std::memory_order_relaxed);
+        if(running) start = Page_Residency::threadFaults();
+    }
+
+    void end() {
+        if(!running) return;
+        const auto now = Page_Residency::threadFaults();
+        const uint64_t minor = now.minor - start.minor;
+        const uint64_t major = now.major - start.major;
+        minorFaults.fetch_add(minor, std::memory_order_relaxed);
+        majorFaults.fetch_add(major, std::memory_order_relaxed);
+        if(minor + major > 0) faultingBlocks.fetch_add(1, std::memory_order_relaxed);
+        blocks.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    /// any thread
+    void fill(Residency_Report& report) const {
+        report.audioMinorFaults = minorFaults.load(std::memory_order_relaxed);
+        report.audioMajorFaults = majorFaults.load(std::memory_order_relaxed);
+        report.faultingBlocks = faultingBlocks.load(std::memory_order_relaxed);
+        report.monitoredBlocks = blocks.load(std::memory_order_relaxed);
+    }
+
+    /// any thread, while audio is stopped
+    void resetCounts() {
+        minorFaults.store(0, std::memory_order_relaxed);
+        majorFaults.store(0, std::memory_order_relaxed);
+        faultingBlocks.store(0, std::memory_order_relaxed);
+        blocks.store(0, std::memory_order_relaxed);
+    }
+
+private:
+    std::atomic<bool> enabled {false};
+    bool running = false;
+    Page_Residency::Fault_Counts start;
+    std::atomic<uint64_t> minorFaults {0};
+    std::atomic<uint64_t> majorFaults {0};
+    std::atomic<uint64_t> faultingBlocks {0};
+    std::atomic<uint64_t> blocks {0};
+};
+
+}
+
+#endif
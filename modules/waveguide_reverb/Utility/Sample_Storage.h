@@ -0,0 +1,185 @@
+#ifndef COLIN_SAMPLE_STORAGE_H
+#define COLIN_SAMPLE_STORAGE_H
+#include <cstdint>
+#include <cstring>
+#if defined(__F16C__)
+#include <immintrin.h>
+#endif
+
+/*
+  ==============================================================================
+
+    Sample_Storage.h
+
+    how a delay line keeps its samples, the 16 bit formats halve the
+    memory (and bandwidth) of the long lines at high sample rates
+
+    COLIN_DELAY_PRECISION 32 keeps floats everywhere, 16 stores the
+    feedback lines as half floats and the diffuser as scaled int16
+
+  ==============================================================================
+*/
+
+#ifndef COLIN_DELAY_PRECISION
+#define COLIN_DELAY_PRECISION 32
+#endif
+
+namespace Colin
+{
+
+/// what a scan of stored samples found, see Health_Monitor.h
+enum Sample_Health : uint32_t {
+    Healthy = 0,
+    Non_Finite = 1, /// nan or inf, circulates forever in a feedback loop
+    Subnormal = 2   /// slow wherever flush to zero is off
+};
+
+/// scan() and flushSubnormals() work on the bits without branches, so the loops vectorise
+struct Float_Storage {
+    using Stored = float;
+
+    static Stored encode(const float x) {
+        return x;
+    }
+
+    static float decode(const Stored s) {
+        return s;
+    }
+
+    static uint32_t scan(const Stored* data, const int n) {
+        uint32_t nonFinite = 0;
+        uint32_t subnormal = 0;
+        for(int i=0; i<n; i++) {
+            uint32_t bits;
+            std::memcpy(&bits, data + i, sizeof(bits));
+            const uint32_t exponent = bits & 0x7f800000u;
+            nonFinite |= static_cast<uint32_t>(exponent == 0x7f800000u);
+            subnormal |= static_cast<uint32_t>(exponent == 0) & static_cast<uint32_t>((bits & 0x007fffffu) != 0);
+        }
+        return (nonFinite != 0 ? Non_Finite : Healthy) | (subnormal != 0 ? Subnormal : Healthy);
+    }
+
+    static void flushSubnormals(Stored* data, const int n) {
+        for(int i=0; i<n; i++) {
+            uint32_t bits;
+            std::memcpy(&bits, data + i, sizeof(bits));
+            bits &= 0u - static_cast<uint32_t>((bits & 0x7f800000u) != 0); // zero exponent, zero sample
+            std::memcpy(data + i, &bits, sizeof(bits));
+        }
+    }
+};
+
+/// ieee binary16, 11 significant bits, saturates at +-65504
+struct Half_Storage {
+    using Stored = uint16_t;
+    static constexpr float MAX = 65504.f;
+
+    static Stored encode(float x) {
+        x = x < -MAX ? -MAX : (x > MAX ? MAX : x); // nan passes through
+#if defined(__F16C__)
+        return static_cast<Stored>(_cvtss_sh(x, _MM_FROUND_TO_NEAREST_INT));
+#elif defined(__aarch64__)
+        const __fp16 h = static_cast<__fp16>(x);
+        Stored s;
+        std::memcpy(&s, &h, sizeof(s));
+        return s;
+#else
+        // round to nearest even, after F. Giesen's float_to_half_fast3_rtne
+        uint32_t bits;
+        std::memcpy(&bits, &x, sizeof(bits));
+        const uint32_t sign = (bits >> 16) & 0x8000u;
+        bits &= 0x7fffffffu;
+        if(bits > 0x7f800000u) return static_cast<Stored>(sign | 0x7e00u); // nan
+        if(bits < 0x38800000u) {
+            // below the smallest normal half, let the fpu round into the subnormal range
+            float f;
+            std::memcpy(&f, &bits, sizeof(f));
+            f += 0.5f;
+            std::memcpy(&bits, &f, sizeof(bits));
+            return static_cast<Stored>(sign | (bits - 0x3f000000u));
+        }
+        const uint32_t odd = (bits >> 13) & 1u;
+        bits += 0xc8000fffu + odd; // rebias the exponent and round
+        return static_cast<Stored>(sign | (bits >> 13));
+#endif
+    }
+
+    static float decode(const Stored s) {
+#if defined(__F16C__)
+        return _cvtsh_ss(s);
+#elif defined(__aarch64__)
+        __fp16 h;
+        std::memcpy(&h, &s, sizeof(h));
+        return static_cast<float>(h);
+#else
+        const uint32_t sign = static_cast<uint32_t>(s & 0x8000u) << 16;
+        uint32_t bits = static_cast<uint32_t>(s & 0x7fffu) << 13;
+        const uint32_t exponent = bits & 0x0f800000u;
+        bits += (127 - 15) << 23;
+        if(exponent == 0x0f800000u) {
+            bits += (128 - 16) << 23; // inf or nan
+        }
+        else if(exponent == 0) {
+            // subnormal half, renormalise through the fpu
+            bits += 1 << 23;
+            float f;
+            std::memcpy(&f, &bits, sizeof(f));
+            f -= 6.103515625e-05f; // 2^-14
+            std::memcpy(&bits, &f, sizeof(bits));
+        }
+        bits |= sign;
+        float f;
+        std::memcpy(&f, &bits, sizeof(f));
+        return f;
+#endif
+    }
+
+    /// half subnormals decode to normal floats, so only nan and inf matter
+    static uint32_t scan(const Stored* data, const int n) {
+        uint32_t nonFinite = 0;
+        for(int i=0; i<n; i++) {
+            nonFinite |= static_cast<uint32_t>((data[i] & 0x7c00u) == 0x7c00u);
+        }
+        return nonFinite != 0 ? Non_Finite : Healthy;
+    }
+
+    static void flushSubnormals(Stored*, int) {}
+};
+
+/// fixed point with 12 dB of headroom, for lines without feedback where a fixed noise floor is fine
+struct Int16_Storage {
+    using Stored = int16_t;
+    static constexpr float FULL_SCALE = 4.f;
+
+    static Stored encode(float x) {
+        if(x != x) return 0; // nan
+        x *= 32767.f / FULL_SCALE;
+        x = x < -32767.f ? -32767.f : (x > 32767.f ? 32767.f : x);
+        return static_cast<Stored>(x < 0.f ? x - 0.5f : x + 0.5f);
+    }
+
+    static float decode(const Stored s) {
+        return static_cast<float>(s) * (FULL_SCALE / 32767.f);
+    }
+
+    /// fixed point has neither
+    static uint32_t scan(const Stored*, int) {
+        return Healthy;
+    }
+
+    static void flushSubnormals(Stored*, int) {}
+};
+
+#if COLIN_DELAY_PRECISION == 16
+/// feedback delay network and waveguide lines
+using Line_Storage = Half_Storage;
+/// diffusion steps and allpasses, which never recirculate for long
+using Diffusion_Storage = Int16_Storage;
+#else
+using Line_Storage = Float_Storage;
+using Diffusion_Storage = Float_Storage;
+#endif
+
+}
+
+#endif
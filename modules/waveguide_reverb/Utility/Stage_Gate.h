@@ -0,0 +1,119 @@
+#ifndef COLIN_STAGE_GATE_H
+#define COLIN_STAGE_GATE_H
+#include <cmath>
+
+/*
+  ==============================================================================
+
+    Stage_Gate.h
+
+    decides once per block whether a processing stage is still audible,
+    an inaudible stage fades out and stops running, and fades back in when needed
+
+  ==============================================================================
+*/
+
+namespace Colin
+{
+
+enum class Prune_Policy {
+    Clear,    /// state is cleared when the stage comes back, so it restarts from silence
+    Keep_Warm /// state is left as it was (costs nothing while idle) and fades back in
+};
+
+class Stage_Gate {
+public:
+    enum class State {
+        Running,
+        Fading_Out,
+        Idle,
+        Fading_In
+    };
+
+    Stage_Gate() = default;
+    ~Stage_Gate() = default;
+
+    void prepare(const double fs, const float fadeMS = 10.f) {
+        const int fadeSamples = static_cast<int>(std::ceil(fs * fadeMS * 0.001));
+        step = 1.f / static_cast<float>(fadeSamples > 0 ? fadeSamples : 1);
+        reset();
+    }
+
+    void reset() {
+        state = State::Running;
+        gain = 1.f;
+    }
+
+    void setThreshold(const float t) {
+        threshold = t;
+    }
+
+    void setPolicy(const Prune_Policy p) {
+        policy = p;
+    }
+
+    /// block rate, contribution is the stage's total gain to the output,
+    /// returns true if the stage must be cleared before it runs again
+    bool update(const float contribution) {
+        const bool audible = std::abs(contribution) > threshold;
+        if(state == State::Running || state == State::Fading_In) {
+            if(!audible) state = State::Fading_Out;
+        }
+        else if(state == State::Fading_Out) {
+            if(audible) state = State::Fading_In;
+        }
+        else if(audible) {
+            state = State::Fading_In;
+            gain = 0.f;
+            return policy == Prune_Policy::Clear;
+        }
+        return false;
+    }
+
+    bool isRunning() const {
+        return state != State::Idle;
+    }
+
+    bool isFading() const {
+        return state == State::Fading_In || state == State::Fading_Out;
+    }
+
+    /// per sample, only needed while isFading()
+    float getNextGain() {
+        if(state == State::Fading_In) {
+            gain += step;
+            if(gain >= 1.f) {
+                gain = 1.f;
+                state = State::Running;
+            }
+        }
+        else if(state == State::Fading_Out) {
+            gain -= step;
+            if(gain <= 0.f) {
+                gain = 0.f;
+                state = State::Idle;
+            }
+        }
+        return gain;
+    }
+
+    /// current fade gain without advancing it
+    float getGain() const {
+        return gain;
+    }
+
+    State getState() const {
+        return state;
+    }
+
+private:
+    State state = State::Running;
+    Prune_Policy policy = Prune_Policy::Clear;
+    float threshold = 0.0001f; /// -80 dB
+    float gain = 1.f;
+    float step = 0.01f;
+};
+
+}
+
+#endif
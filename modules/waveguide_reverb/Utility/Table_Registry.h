@@ -0,0 +1,66 @@
+#ifndef COLIN_TABLE_REGISTRY_H
+#define COLIN_TABLE_REGISTRY_H
+#include <memory>
+#include <utility>
+#include <vector>
+#include "juce_core/juce_core.h"
+
+/*
+  ==============================================================================
+
+    Table_Registry.h
+
+    one per table type per process (juce::SharedResourcePointer), every
+    instance running at a sample rate shares a single immutable copy of
+    the table for it, the last instance to let go frees it
+
+  ==============================================================================
+*/
+
+namespace Colin
+{
+
+/// Table has to be constructible from the sample rate
+template<typename Table>
+class Table_Registry {
+public:
+    Table_Registry() = default;
+    ~Table_Registry() = default;
+
+    /// never on the audio thread, builds the table the first time a rate is asked for
+    std::shared_ptr<const Table> get(const double fs) {
+        const juce::ScopedLock lock(tablesLock);
+        std::shared_ptr<const Table> table;
+        for(auto it = tables.begin(); it != tables.end();) {
+            if(it->second.expired()) {
+                it = tables.erase(it);
+                continue;
+            }
+            if(it->first == fs) table = it->second.lock();
+            ++it;
+        }
+        if(table == nullptr) {
+            table = std::make_shared<const Table>(fs);
+            tables.emplace_back(fs, table);
+        }
+        return table;
+    }
+
+    /// rates with a table somebody still holds
+    int getNumTables() const {
+        const juce::ScopedLock lock(tablesLock);
+        int live = 0;
+        for(const auto& entry : tables) {
+            if(!entry.second.expired()) live++;
+        }
+        return live;
+    }
+
+private:
+    juce::CriticalSection tablesLock;
+    std::vector<std::pair<double, std::weak_ptr<const Table>>> tables;
+};
+
+}
+
+#endif
@@ -0,0 +1,123 @@
+#ifndef COLIN_UPDATE_SCHEDULER_H
+#define COLIN_UPDATE_SCHEDULER_H
+#include "juce_core/juce_core.h"
+
+/*
+  ==============================================================================
+
+    Update_Scheduler.h
+
+    expensive recomputations (retuning the strings, rebuilding the diffuser)
+    split into units and spread over the blocks after a change, each block
+    runs units until its time budget is spent, a job's commit only runs once
+    all its units are done so whatever it applies changes in one go
+
+  ==============================================================================
+*/
+
+namespace Colin
+{
+
+class Update_Scheduler {
+public:
+    static constexpr int MAX_JOBS = 8;
+
+    /// one unit of a job, returns false if there was nothing to do for it (it then costs no budget)
+    using Step = bool (*)(void* context, int unit);
+    /// after the last unit, may be nullptr
+    using Commit = void (*)(void* context);
+
+    /// once, e.g. from the owner's constructor, returns the id to schedule the job with
+    int addJob(Step step, Commit commit, void* context, const int numUnits) {
+        jassert(numJobs < MAX_JOBS);
+        jobs[numJobs] = {step, commit, context, numUnits};
+        return numJobs++;
+    }
+
+    /// audio thread, how long each block may spend on updates, 0 runs every job to the end
+    /// as soon as it is scheduled (deterministic, for offline renders)
+    void setBudget(const double microseconds) {
+        budgetTicks = static_cast<juce::int64>(microseconds * 1.0e-6 * static_cast<double>(juce::Time::getHighResolutionTicksPerSecond()));
+    }
+
+    bool isBudgeted() const {
+        return budgetTicks > 0;
+    }
+
+    /// audio thread, a job that is already running goes round again once it is done,
+    /// so a parameter sweep can't keep restarting it before it commits, one that hasn't
+    /// run a unit yet picks the change up as it is
+    void schedule(const int id) {
+        Job& job = jobs[id];
+        if(job.next < 0) job.next = 0;
+        else if(job.next > 0) job.again = true;
+        if(!isBudgeted()) finish(job);
+    }
+
+    /// audio thread, once per block, always gets at least one unit of real work done
+    void run() {
+        const juce::int64 start = juce::Time::getHighResolutionTicks();
+        bool worked = false;
+        for(int j = 0; j < numJobs; j++) {
+            Job& job = jobs[j];
+            while(job.next >= 0) {
+                while(job.next < job.numUnits) {
+                    if(worked && juce::Time::getHighResolutionTicks() - start > budgetTicks) return;
+                    if(job.step(job.context, job.next++)) worked = true;
+                }
+                complete(job);
+            }
+        }
+    }
+
+    /// everything pending, right now, e.g. from prepareToPlay
+    void finishAll() {
+        for(int j = 0; j < numJobs; j++) {
+            finish(jobs[j]);
+        }
+    }
+
+    bool isPending(const int id) const {
+        return jobs[id].next >= 0;
+    }
+
+    bool isIdle() const {
+        for(int j = 0; j < numJobs; j++) {
+            if(jobs[j].next >= 0) return false;
+        }
+        return true;
+    }
+
+private:
+    struct Job {
+        Step step = nullptr;
+        Commit commit = nullptr;
+        void* context = nullptr;
+        int numUnits = 0;
+        int next = -1; /// the next unit to run, -1 while idle
+        bool again = false;
+    };
+
+    Job jobs[MAX_JOBS];
+    int numJobs = 0;
+    juce::int64 budgetTicks = 0;
+
+    void complete(Job& job) {
+        if(job.commit != nullptr) job.commit(job.context);
+        job.next = job.again ? 0 : -1;
+        job.again = false;
+    }
+
+    void finish(Job& job) {
+        while(job.next >= 0) {
+            while(job.next < job.numUnits) {
+                job.step(job.context, job.next++);
+            }
+            complete(job);
+        }
+    }
+};
+
+}
+
+#endif
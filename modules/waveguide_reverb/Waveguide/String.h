@@ -4,7 +4,8 @@
 #include <memory>
 
 #include "../Reverb/Delay.h"
-#include "../Utility/Biquad.h"
+#include "../Utility/Kernels.h"
+#include "Tuning.h"
 #include "juce_dsp/juce_dsp.h"
 
 /*
@@ -21,24 +22,69 @@ namespace Colin {
 
 class Waveguide_String {
 public:
+    static constexpr int LOWEST_NOTE = 0; /// midi note
+
+    /// a tuning and shape worked out ahead by plan(), apply() only writes it into the string
+    struct Setup {
+        Tuning_Row tuning;
+        float decayTime = 0.9f;
+        float pickupPosition = 0.8f;
+        float triggerPosition = 0.2f;
+        float length = 0.f;
+        float fractional = 0.f;
+        int roundLength = 0;
+        int forwardPickupIndex = 0;
+        int forwardTriggerIndex = 0;
+        double decayCoeff = 0.0;
+    };
+
     Waveguide_String() = default;
     ~Waveguide_String() = default;
 
-    void prepareToPlay(const double fs) {
+    /// lowestNote sizes the lines, nothing below it may be played
+    void prepareToPlay(const double fs, const int lowestNote = LOWEST_NOTE) {
         sampleRate = fs;
+        // room for the lowest note we can be asked to play, so retuning never allocates
+        const int capacity = getLineCapacity(fs, lowestNote);
+        forwardLine.reserve(capacity);
+        backwardLine.reserve(capacity);
+        // first order coefficient objects are created once and rewritten in place afterwards,
+        // a 250 Hz row holds the 1 kHz lowpass and 250 Hz allpass every string starts from
+        if(LPF.coefficients == nullptr) {
+            LPF.coefficients = juce::dsp::IIR::Coefficients<float>::makeFirstOrderLowPass(fs, 1000.f);
+            APFforward.coefficients = juce::dsp::IIR::Coefficients<float>::makeFirstOrderAllPass(fs, 250.f);
+            APFbackward.coefficients = juce::dsp::IIR::Coefficients<float>::makeFirstOrderAllPass(fs, 250.f);
+        }
+        const Tuning_Row initial = Tuning_Row::make(fs, 250.f);
+        setCoefficients(LPF, initial.lpf);
+        setCoefficients(APFforward, initial.apf);
+        setCoefficients(APFbackward, initial.apf);
         juce::dsp::ProcessSpec spec(fs, 512, 2);
         LPF.prepare(spec);
         APFforward.prepare(spec);
         APFbackward.prepare(spec);
-        bodyFilters.resize(16);
-        for(size_t i=0; i<16; i++) {
-            bodyFilters[i].setCoefficients(bodyB[0], bodyB[1], bodyB[2], bodyA[i][1], bodyA[i][2]);
+        for(int i=0; i<Modal_Bank::NUM_MODES; i++) {
+            bodyModes.setCoefficients(i, bodyB[0], bodyB[1], bodyB[2], bodyA[i][1], bodyA[i][2]);
         }
+        // forget the old note, so the next tuning is worked out for this rate
+        frequency = 0.f;
+        enabled = false;
+        clear();
     }
 
     void setFrequency(const float freq) {
-        if(juce::approximatelyEqual(freq, frequency)) return;
-        frequency = freq;
+        setTuning(Tuning_Row::make(sampleRate, freq));
+    }
+
+    /// real-time safe, the row is copied and the delay lines stay within their reserved size
+    void setTuning(const Tuning_Row& row) {
+        if(juce::approximatelyEqual(row.frequency, frequency) && enabled) {
+            // asked for the note it is already playing, so it should keep ringing
+            shouldReset = false;
+            return;
+        }
+        tuning = row;
+        frequency = row.frequency;
         if(juce::approximatelyEqual(frequency, 0.f)) {
             enabled = false;
             return;
@@ -68,6 +114,61 @@ public:
         updateParameters();
     }
 
+    /// decay time, pickup and trigger position at once, the string is only worked out again once,
+    /// returns false if nothing changed
+    bool setShape(const float time, const float pickup, const float trigger) {
+        if(hasShape(time, pickup, trigger)) return false;
+        decayTime = time;
+        pickupPosition = pickup;
+        triggerPosition = trigger;
+        updateParameters();
+        return true;
+    }
+
+    /// real-time safe and leaves the string alone, the maths of a retune or reshape
+    Setup plan(const Tuning_Row& row, const float time, const float pickup, const float trigger) const {
+        Setup setup;
+        setup.tuning = row;
+        setup.decayTime = time;
+        setup.pickupPosition = pickup;
+        setup.triggerPosition = trigger;
+        if(row.frequency <= 0.f) return setup;
+        setup.length = static_cast<float>(sampleRate) / row.frequency;
+        setup.roundLength = juce::roundToInt(setup.length);
+        setup.fractional = (setup.length - static_cast<float>(setup.roundLength)) / setup.length;
+        setup.forwardPickupIndex = juce::roundToInt(juce::jmap(pickup, 0.f, static_cast<float>(setup.roundLength) / 2.f - 1));
+        setup.forwardTriggerIndex = juce::roundToInt(juce::jmap(trigger, 0.f, static_cast<float>(setup.roundLength) / 2.f - 1));
+        setup.decayCoeff = juce::jmap(static_cast<double>(time), std::pow(0.9999, static_cast<double>(setup.roundLength)), std::pow(0.999999, static_cast<double>(setup.roundLength)));
+        if(setup.decayCoeff >= 0.9999) setup.decayCoeff = 0.9999;
+        return setup;
+    }
+
+    /// real-time safe, a plan() for this rate goes in at once, asked for the note and shape it is
+    /// already playing it keeps ringing, returns false if nothing changed
+    bool apply(const Setup& setup) {
+        if(enabled && juce::approximatelyEqual(setup.tuning.frequency, frequency) && hasShape(setup.decayTime, setup.pickupPosition, setup.triggerPosition)) {
+            shouldReset = false;
+            return false;
+        }
+        tuning = setup.tuning;
+        frequency = setup.tuning.frequency;
+        decayTime = setup.decayTime;
+        pickupPosition = setup.pickupPosition;
+        triggerPosition = setup.triggerPosition;
+        enabled = !juce::approximatelyEqual(frequency, 0.f);
+        write(setup);
+        return true;
+    }
+
+    bool hasShape(const float time, const float pickup, const float trigger) const {
+        return juce::approximatelyEqual(time, decayTime) && juce::approximatelyEqual(pickup, pickupPosition)
+            && juce::approximatelyEqual(trigger, triggerPosition);
+    }
+
+    const Tuning_Row& getTuning() const {
+        return tuning;
+    }
+
     void resetAfterDecay() {
         shouldReset = true;
     }
@@ -78,6 +179,42 @@ public:
         shouldReset = false;
     }
 
+    /// reset() plus every filter state, so the string restarts from silence
+    void clear() {
+        reset();
+        LPF.reset();
+        APFforward.reset();
+        APFbackward.reset();
+        bodyModes.reset();
+    }
+
+    /// never on the audio thread, the lines go back to the pool until the next prepareToPlay
+    void release() {
+        forwardLine.release();
+        backwardLine.release();
+    }
+
+    /// never on the audio thread, maps the whole reserved room of both lines in
+    Residency_Bytes prefault(const bool lock) {
+        Residency_Bytes bytes = forwardLine.prefault(lock);
+        bytes += backwardLine.prefault(lock);
+        return bytes;
+    }
+
+    /// block rate, count is how many samples ran since the last check, a non finite
+    /// string is cleared, returns Sample_Health flags
+    uint32_t checkHealth(const int count) {
+        const uint32_t flags = forwardLine.checkHealth(count) | backwardLine.checkHealth(count);
+        if(flags & Non_Finite) {
+            clear();
+            return flags;
+        }
+        LPF.snapToZero();
+        APFforward.snapToZero();
+        APFbackward.snapToZero();
+        return flags;
+    }
+
     void addSample(const float sample) {
         forwardLine.add(sample);
         backwardLine.add(sample);
@@ -106,10 +243,7 @@ public:
     }
 
     float applyBodyFilters(const float sample) {
-        float output = 0.f;
-        for(size_t i=0; i<16; i++) {
-            output += bodyFilters[i].processAudioSample(sample);
-        }
+        float output = kernels->modalBank(bodyModes, sample);
         output /= 40.f; // scaling to prevent values exceeding -1 to 1
         return output;
     }
@@ -118,13 +252,21 @@ public:
         return length;
     }
 
+    static int getLineCapacity(const double fs, const int lowestNote) {
+        return static_cast<int>(std::ceil(fs / Tuning::midiToFreq(lowestNote))) + 1;
+    }
+
+    size_t getAllocatedBytes() const {
+        return forwardLine.getAllocatedBytes() + backwardLine.getAllocatedBytes();
+    }
+
     void trigger(const float velocity) {
         for (int i=0; i<=forwardPickupIndex; i++) {
             const float val = juce::jmap(static_cast<float>(i), 0.f, static_cast<float>(forwardTriggerIndex), 0.f, velocity / 2.f);
             forwardLine.setAt(i, val);
             backwardLine.setAt(juce::roundToInt(length) - 1 - i, val);
         }
-        for (int i=forwardTriggerIndex; i<=juce::roundToInt(length); i++) {
+        for (int i=forwardTriggerIndex; i<juce::roundToInt(length); i++) {
             const float val = juce::jmap(static_cast<float>(i), static_cast<float>(forwardTriggerIndex), length - 1, velocity / 2.f, 0.f);
             forwardLine.setAt(i, val);
             backwardLine.setAt(juce::roundToInt(length) - 1 - i, val);
@@ -142,17 +284,18 @@ private:
     int backwardPickupIndex;
     int forwardTriggerIndex;
     float fractional = 0.f;
-    float frequency;
+    float frequency = 0.f;
+    Tuning_Row tuning;
     float pickupPosition = 0.8f;
     float triggerPosition = 0.2f;
     float decayTime = 0.9f;
     double decayCoeff;
     float length;
     bool shouldReset = false;
-    bool enabled;
+    bool enabled = false;
 
-    // Violin Body Modal Filters
-    const double bodyA[16][3] = {{1,	-1.99447342188475,	0.995775119117750},
+    // Violin Body Modal Filters, shared by every string
+    static constexpr double bodyA[16][3] = {{1,	-1.99447342188475,	0.995775119117750},
         {1,	-1.99379494705379,	0.995907928516203},
         {1,	-1.99201110254198,	0.995637097398487},
         {1,	-1.98804163175910,	0.993001329351293},
@@ -168,26 +311,36 @@ private:
         {1,	-1.97971903689756,	0.994452995604781},
         {1,	-1.97550615542992,	0.994395384672155},
         {1,	-1.96686686949208,	0.989964816263091}};
-    const double bodyB[3] = {1, 0, -1};
-    std::vector<Biquad_Filter> bodyFilters;
+    static constexpr double bodyB[3] = {1, 0, -1};
+    Modal_Bank bodyModes;
+    const Kernel_Table* kernels = &Kernel_Dispatch::get(); /// picked for this cpu
+
+
+    static void setCoefficients(juce::dsp::IIR::Filter<float>& filter, const float* c) {
+        std::copy(c, c + 3, filter.coefficients->getRawCoefficients());
+    }
 
     void updateParameters() {
-        length = static_cast<float>(sampleRate) / frequency;
-        const int roundLength = juce::roundToInt(length);
-        fractional = (length - static_cast<float>(roundLength)) / length;
-        forwardLine.resize(roundLength);
-        backwardLine.resize(roundLength);
-        forwardPickupIndex = juce::roundToInt(juce::jmap(pickupPosition, 0.f, static_cast<float>(roundLength) / 2.f - 1));
-        backwardPickupIndex = roundLength - 1 - forwardPickupIndex;
-        forwardTriggerIndex = juce::roundToInt(juce::jmap(triggerPosition, 0.f, static_cast<float>(roundLength) / 2.f - 1));
+        if(frequency <= 0.f) return;
+        write(plan(tuning, decayTime, pickupPosition, triggerPosition));
+    }
+
+    void write(const Setup& setup) {
+        if(setup.tuning.frequency <= 0.f) return;
+        length = setup.length;
+        fractional = setup.fractional;
+        forwardLine.resize(setup.roundLength);
+        backwardLine.resize(setup.roundLength);
+        forwardPickupIndex = setup.forwardPickupIndex;
+        backwardPickupIndex = setup.roundLength - 1 - forwardPickupIndex;
+        forwardTriggerIndex = setup.forwardTriggerIndex;
         LPF.reset();
-        LPF.coefficients = juce::dsp::IIR::Coefficients<float>::makeFirstOrderLowPass(sampleRate, 4 * frequency);
+        setCoefficients(LPF, setup.tuning.lpf);
         APFforward.reset();
-        APFforward.coefficients = juce::dsp::IIR::Coefficients<float>::makeFirstOrderAllPass(sampleRate, frequency);
+        setCoefficients(APFforward, setup.tuning.apf);
         APFbackward.reset();
-        APFbackward.coefficients = juce::dsp::IIR::Coefficients<float>::makeFirstOrderAllPass(sampleRate, frequency);
-        decayCoeff = juce::jmap(static_cast<double>(decayTime), std::pow(0.9999, static_cast<double>(roundLength)), std::pow(0.999999, static_cast<double>(roundLength)));
-        if(decayCoeff >= 0.9999) decayCoeff = 0.9999;
+        setCoefficients(APFbackward, setup.tuning.apf);
+        decayCoeff = setup.decayCoeff;
         reset();
     }
 };
@@ -199,27 +352,28 @@ public:
         strings.clear();
     }
 
-    void prepareToPlay(double fs) {
-        strings.clear();
-        lengths.clear();
-        counters.clear();
+    /// the strings are created once, later prepares reuse their lines (a higher lowestNote gives memory back)
+    void prepareToPlay(double fs, const int lowestNote = Waveguide_String::LOWEST_NOTE) {
+        if(strings.empty()) {
+            for(size_t i = 0; i < NUM_CHANNELS; i++) {
+                strings.push_back(std::make_unique<Waveguide_String>());
+            }
+        }
         for(size_t i = 0; i < NUM_CHANNELS; i++) {
-            auto s = std::make_unique<Waveguide_String>();
-            strings.push_back(std::move(s));
-            strings[i]->prepareToPlay(fs);
+            strings[i]->prepareToPlay(fs, lowestNote);
             strings[i]->setFrequency(261.63f); // middle C
-            lengths.push_back(juce::roundToInt(strings[i]->getLength()));
-            counters.push_back(0);
+            lengths[i] = juce::roundToInt(strings[i]->getLength());
+            counters[i] = 0;
         }
     }
 
-    data process(data input) {
+    data process(const data& input) {
         data output;
         for(size_t i = 0; i < NUM_CHANNELS; i++) {
             auto sample = strings[i]->getSample();
             jassert(std::abs(sample) < 1.f);
             output.channels[i] = sample; // / NUM_CHANNELS
-            if(counters[i] >= juce::roundToInt(triggerRate) * lengths[i]) {
+            if(i < activeVoices && counters[i] >= juce::roundToInt(triggerRate) * lengths[i]) {
                 if(input.channels[i] >= 0.01f) {
                     float velocity = juce::jmap(input.channels[i], 0.f, 1.f, 0.f, 0.7f);
                     strings[i]->trigger(velocity);
@@ -231,13 +385,34 @@ public:
         return output;
     }
 
-    void setFrequencies(std::vector<float> freqs) {
-        lengths.clear();
-        for(size_t i = 0; i < NUM_CHANNELS; i++) {
-            strings[i]->setFrequency(freqs[i % freqs.size()]);
-            lengths.push_back(juce::roundToInt(strings[i]->getLength() + i * 5));
-            //lengths.push_back(juce::roundToInt(strings[i]->getLength()));
-        }
+    /// works out a retune or reshape of a single voice without touching it, real-time safe
+    Waveguide_String::Setup planVoice(const size_t voice, const Tuning_Row& row, const float decay, const float pickup, const float trigger) const {
+        return strings[voice]->plan(row, decay, pickup, trigger);
+    }
+
+    /// puts a planVoice in, real-time safe
+    void applyVoice(const size_t voice, const Waveguide_String::Setup& setup) {
+        strings[voice]->apply(setup);
+        lengths[voice] = juce::roundToInt(strings[voice]->getLength() + voice * 5);
+        //lengths[voice] = juce::roundToInt(strings[voice]->getLength());
+    }
+
+    const Tuning_Row& getTuning(const size_t voice) const {
+        return strings[voice]->getTuning();
+    }
+
+    bool hasShape(const size_t voice, const float decay, const float pickup, const float trigger) const {
+        return strings[voice]->hasShape(decay, pickup, trigger);
+    }
+
+    /// lets a single voice ring out and then go quiet
+    void releaseVoice(const size_t voice) {
+        strings[voice]->resetAfterDecay();
+    }
+
+    /// only the first count voices are plucked, the others ring out and cost next to nothing once quiet
+    void setActiveVoices(const size_t count) {
+        activeVoices = std::min(count, static_cast<size_t>(NUM_CHANNELS));
     }
 
     void resetAfterDecay() {
@@ -246,28 +421,50 @@ public:
         }
     }
 
-    void setDecay(const float d) const {
-        //d = juce::jmap(d, 0.f, 1.f, 0.7f, 2.5f);
-        for(size_t i = 0; i < NUM_CHANNELS; i++) {
-            strings[i]->setDecayTime(d);
+    /// silences every string, tunings are kept
+    void clear() {
+        for(size_t i = 0; i < strings.size(); i++) {
+            strings[i]->clear();
+            counters[i] = 0;
         }
     }
 
-    void setRate(float r) {
-        r = juce::jmap(r, 0.f, 1.f, 500.f, 50.f);
-        triggerRate = r;
+    /// never on the audio thread, the strings are rebuilt by the next prepareToPlay
+    void release() {
+        for(auto& s : strings) {
+            s->release();
+        }
+        strings.clear();
     }
 
-    void setTriggerPosition(const float position) const {
-        for(size_t i = 0; i < NUM_CHANNELS; i++) {
-            strings[i]->setTriggerPosition(position);
+    Residency_Bytes prefault(const bool lock) {
+        Residency_Bytes bytes;
+        for(auto& s : strings) {
+            bytes += s->prefault(lock);
         }
+        return bytes;
     }
 
-    void setPickupPosition(const float position) const {
-        for(size_t i = 0; i < NUM_CHANNELS; i++) {
-            strings[i]->setPickupPosition(position);
+    uint32_t checkHealth(const int count, int& linesCleared) {
+        uint32_t flags = Healthy;
+        for(auto& s : strings) {
+            const uint32_t f = s->checkHealth(count);
+            if(f & Non_Finite) linesCleared++;
+            flags |= f;
         }
+        return flags;
+    }
+
+    /// one string at a time, so a knob sweep can be spread over several blocks
+    bool setShape(const size_t voice, const float decay, const float pickup, const float trigger) const {
+        //d = juce::jmap(d, 0.f, 1.f, 0.7f, 2.5f);
+        if(voice >= strings.size()) return false;
+        return strings[voice]->setShape(decay, pickup, trigger);
+    }
+
+    void setRate(float r) {
+        r = juce::jmap(r, 0.f, 1.f, 500.f, 50.f);
+        triggerRate = r;
     }
 
     bool isInitialised() const {
@@ -275,10 +472,19 @@ public:
         return true;
     }
 
+    size_t getAllocatedBytes() const {
+        size_t bytes = strings.capacity() * sizeof(std::unique_ptr<Waveguide_String>);
+        for(const auto& s : strings) {
+            bytes += sizeof(Waveguide_String) + s->getAllocatedBytes();
+        }
+        return bytes;
+    }
+
 private:
     std::vector<std::unique_ptr<Waveguide_String>> strings;
-    std::vector<int> lengths;
-    std::vector<int> counters;
+    int lengths[NUM_CHANNELS] = {0};
+    int counters[NUM_CHANNELS] = {0};
+    size_t activeVoices = NUM_CHANNELS;
     float triggerRate;
 };
 
@@ -0,0 +1,134 @@
+#ifndef COLIN_TUNING_H
+#define COLIN_TUNING_H
+#include <array>
+#include <cmath>
+#include "../Reverb/Mix_Matrix.h"
+
+/*
+  ==============================================================================
+
+    Tuning.h
+
+    everything a string needs to change pitch, worked out ahead of time
+    so retuning on the audio thread is only a copy
+
+  ==============================================================================
+*/
+
+namespace Colin
+{
+
+struct Tuning_Row {
+    float frequency = 0.f;
+    float lpf[3] = {0.f}; /// first order b0, b1, a1 (a0 normalised out)
+    float apf[3] = {0.f};
+
+    /// same coefficients as juce::dsp::IIR::Coefficients::makeFirstOrderLowPass/AllPass, without allocating
+    static Tuning_Row make(const double fs, const float freq) {
+        Tuning_Row row;
+        row.frequency = freq;
+        if(freq <= 0.f) return row;
+        const float pi = 3.14159265358979323846f;
+
+        float n = std::tan(pi * (4.f * freq) / static_cast<float>(fs));
+        float inv = 1.f / (n + 1.f);
+        row.lpf[0] = n * inv;
+        row.lpf[1] = n * inv;
+        row.lpf[2] = (n - 1.f) * inv;
+
+        n = std::tan(pi * freq / static_cast<float>(fs));
+        inv = 1.f / (n + 1.f);
+        row.apf[0] = (n - 1.f) * inv;
+        row.apf[1] = (n + 1.f) * inv;
+        row.apf[2] = (n - 1.f) * inv;
+        return row;
+    }
+};
+
+/// a full set of string pitches, one root and chord of Tuning_Bank
+struct Tuning {
+    int numNotes = 0;
+    std::array<int, NUM_CHANNELS> notes {};
+    std::array<Tuning_Row, NUM_CHANNELS> rows {};
+
+    static float midiToFreq(const int midi) {
+        return std::pow(2.f, (static_cast<float>(midi) - 69.f) / 12.f) * 440.f;
+    }
+
+    void addNote(const double fs, const int midi) {
+        if(numNotes >= NUM_CHANNELS) return;
+        notes[static_cast<size_t>(numNotes)] = midi;
+        rows[static_cast<size_t>(numNotes)] = Tuning_Row::make(fs, midiToFreq(midi));
+        numNotes++;
+    }
+};
+
+/// one row per midi note for a given sample rate, immutable once built so every
+/// instance at that rate can share one through Table_Registry
+struct Tuning_Table {
+    static constexpr int NUM_NOTES = 128;
+    double sampleRate = 0;
+    std::array<Tuning_Row, NUM_NOTES> rows {};
+
+    Tuning_Table() = default;
+    explicit Tuning_Table(const double fs) {
+        build(fs);
+    }
+
+    void build(const double fs) {
+        if(sampleRate == fs) return;
+        sampleRate = fs;
+        for(size_t i=0; i<NUM_NOTES; i++) {
+            rows[i] = Tuning_Row::make(fs, Tuning::midiToFreq(static_cast<int>(i)));
+        }
+    }
+
+    const Tuning_Row& operator[](const int note) const {
+        return rows[static_cast<size_t>(note < 0 ? 0 : (note >= NUM_NOTES ? NUM_NOTES - 1 : note))];
+    }
+};
+
+/// every root and chord the plugin offers, built on the message thread for one sample rate,
+/// so changing either on the audio thread only picks a different entry, shared like Tuning_Table
+struct Tuning_Bank {
+    static constexpr int NUM_ROOTS = 12;
+    static constexpr int NUM_CHORDS = 7;
+    static constexpr int CHORD_SIZE = 4;
+    static constexpr int LOWEST_ROOT = 48; /// the root parameter's C
+    /// by ChordType, Midi_Input and out of range chords leave the strings to the held notes
+    static constexpr int chordDegrees[NUM_CHORDS][CHORD_SIZE] = {
+        {0, 0, 0, 0}, /// Midi_Input, no chord
+        {0, 0, 0, 0},
+        {0, 4, 7, 12},
+        {0, 3, 7, 12},
+        {0, 4, 7, 10},
+        {0, 4, 7, 11},
+        {0, 3, 7, 10}};
+
+    double sampleRate = 0;
+    std::array<Tuning, NUM_ROOTS * NUM_CHORDS> tunings {};
+
+    Tuning_Bank() = default;
+    explicit Tuning_Bank(const double fs) {
+        sampleRate = fs;
+        for(int root = 0; root < NUM_ROOTS; root++) {
+            for(int chord = 1; chord < NUM_CHORDS; chord++) {
+                auto& tuning = tunings[static_cast<size_t>(root * NUM_CHORDS + chord)];
+                for(const int degree : chordDegrees[chord]) {
+                    tuning.addNote(fs, LOWEST_ROOT + root + degree);
+                }
+            }
+        }
+    }
+
+    /// root 0 to 11 from C, anything out of range is clamped
+    const Tuning& get(const int root, const int chord) const {
+        const int r = root < 0 ? 0 : (root >= NUM_ROOTS ? NUM_ROOTS - 1 : root);
+        const int c = chord < 0 ? 0 : (chord >= NUM_CHORDS ? 0 : chord);
+        return tunings[static_cast<size_t>(r * NUM_CHORDS + c)];
+    }
+};
+
+}
+
+#endif
@@ -0,0 +1,203 @@
+#ifndef COLIN_VOICE_ALLOCATOR_H
+#define COLIN_VOICE_ALLOCATOR_H
+#include <algorithm>
+#include <cstdint>
+#include "../Reverb/Mix_Matrix.h"
+
+/*
+  ==============================================================================
+
+    Voice_Allocator.h
+
+    fixed size note tracking for the string bank, nothing in here allocates
+
+  ==============================================================================
+*/
+
+namespace Colin
+{
+
+/// held notes in the order they were pressed
+class Note_Stack {
+public:
+    static constexpr int CAPACITY = 128;
+
+    Note_Stack() = default;
+    ~Note_Stack() = default;
+
+    /// a note that is already held moves to the top
+    void push(const int note) {
+        remove(note);
+        if(size == CAPACITY) return;
+        notes[size++] = note;
+    }
+
+    void remove(const int note) {
+        for(int i=0; i<size; i++) {
+            if(notes[i] == note) {
+                std::copy(notes + i + 1, notes + size, notes + i);
+                size--;
+                return;
+            }
+        }
+    }
+
+    void clear() {
+        size = 0;
+    }
+
+    bool isEmpty() const {
+        return size == 0;
+    }
+
+    int getSize() const {
+        return size;
+    }
+
+    const int* begin() const {
+        return notes;
+    }
+
+    const int* end() const {
+        return notes + size;
+    }
+
+private:
+    int notes[CAPACITY] = {0};
+    int size = 0;
+};
+
+/// which held notes lose their voices once there are more notes than strings
+enum class Steal_Policy {
+    Oldest,  /// most recently pressed notes sound
+    Lowest,  /// highest notes sound
+    Highest  /// lowest notes sound
+};
+
+/// spreads the sounding notes evenly over the string voices, keeping every voice
+/// whose note is still wanted so only the voices that really change get retuned
+class Voice_Allocator {
+public:
+    static constexpr int NUM_VOICES = NUM_CHANNELS;
+    static constexpr int NO_NOTE = -1;
+
+    Voice_Allocator() {
+        reset();
+    }
+    ~Voice_Allocator() = default;
+
+    void reset() {
+        std::fill(voiceNotes, voiceNotes + NUM_VOICES, NO_NOTE);
+    }
+
+    void setPolicy(const Steal_Policy p) {
+        policy = p;
+    }
+
+    /// only the first limit voices get notes, the next allocate releases the rest
+    void setVoiceLimit(const int limit) {
+        voiceLimit = std::clamp(limit, 1, NUM_VOICES);
+    }
+
+    int getVoiceLimit() const {
+        return voiceLimit;
+    }
+
+    /// notes in press order, returns a bit per voice whose note changed
+    uint32_t allocate(const int* notes, const int numNotes) {
+        int sounding[NUM_VOICES];
+        const int numSounding = selectSounding(notes, numNotes, sounding);
+
+        int target[NUM_VOICES] = {0};
+        int count[NUM_VOICES] = {0};
+        if(numSounding > 0) {
+            for(int k=0; k<numSounding; k++) {
+                target[k] = voiceLimit / numSounding + (k < voiceLimit % numSounding ? 1 : 0);
+            }
+        }
+
+        int previous[NUM_VOICES];
+        std::copy(voiceNotes, voiceNotes + NUM_VOICES, previous);
+
+        // keep voices that already play a wanted note
+        for(int v=0; v<NUM_VOICES; v++) {
+            const int k = indexOf(sounding, numSounding, voiceNotes[v]);
+            if(v < voiceLimit && k >= 0 && count[k] < target[k]) {
+                count[k]++;
+            }
+            else {
+                voiceNotes[v] = NO_NOTE;
+            }
+        }
+
+        // hand the free voices round robin to the notes that are short,
+        // from scratch this gives voice v the note v % numSounding
+        int k = 0;
+        for(int v=0; v<voiceLimit && numSounding > 0; v++) {
+            if(voiceNotes[v] != NO_NOTE) continue;
+            while(count[k] >= target[k]) k = (k + 1) % numSounding;
+            voiceNotes[v] = sounding[k];
+            count[k]++;
+            k = (k + 1) % numSounding;
+        }
+
+        uint32_t changed = 0;
+        for(int v=0; v<NUM_VOICES; v++) {
+            if(voiceNotes[v] != previous[v]) changed |= 1u << v;
+        }
+        return changed;
+    }
+
+    int getNote(const int voice) const {
+        return voiceNotes[voice];
+    }
+
+private:
+    int voiceNotes[NUM_VOICES];
+    int voiceLimit = NUM_VOICES;
+    Steal_Policy policy = Steal_Policy::Oldest;
+
+    static int indexOf(const int* notes, const int numNotes, const int note) {
+        for(int i=0; i<numNotes; i++) {
+            if(notes[i] == note) return i;
+        }
+        return -1;
+    }
+
+    /// picks at most voiceLimit distinct notes, keeping press order among the survivors
+    int selectSounding(const int* notes, const int numNotes, int* sounding) const {
+        int n = 0;
+        if(policy == Steal_Policy::Oldest) {
+            // walk back from the newest note so the oldest ones are dropped
+            for(int i=numNotes-1; i>=0 && n<voiceLimit; i--) {
+                if(indexOf(sounding, n, notes[i]) < 0) sounding[n++] = notes[i];
+            }
+            std::reverse(sounding, sounding + n);
+            return n;
+        }
+
+        for(int i=0; i<numNotes; i++) {
+            if(indexOf(sounding, n, notes[i]) >= 0) continue;
+            if(n < voiceLimit) {
+                sounding[n++] = notes[i];
+                continue;
+            }
+            // full, replace the note the policy would steal if the new one ranks higher
+            int victim = 0;
+            for(int j=1; j<n; j++) {
+                const bool lower = sounding[j] < sounding[victim];
+                if(policy == Steal_Policy::Lowest ? lower : !lower) victim = j;
+            }
+            const bool better = policy == Steal_Policy::Lowest ? notes[i] > sounding[victim] : notes[i] < sounding[victim];
+            if(better) {
+                std::copy(sounding + victim + 1, sounding + n, sounding + victim);
+                sounding[n - 1] = notes[i];
+            }
+        }
+        return n;
+    }
+};
+
+}
+
+#endif
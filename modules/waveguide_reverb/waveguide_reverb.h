@@ -17,6 +17,7 @@ END_JUCE_MODULE_DECLARATION
 #pragma once
 
 #include "waveguide_reverb/Hybrid/WaveVerb.h"
+#include "waveguide_reverb/Utility/Dirty_Mask.h"
 
 
 
@@ -11,6 +11,7 @@ namespace IDs {
     static juce::String roomSize {"roomSize"};
     static juce::String rt60 {"rt60"};
     static juce::String lowPass {"lowPass"};
+    static juce::String freeze {"freeze"};
     static juce::String modelType {"modelType"};
     static juce::String rootNote {"rootNote"};
     static juce::String chordType {"chordType"};
@@ -18,6 +19,23 @@ namespace IDs {
     static juce::String waveguideB {"waveguideB"};
     static juce::String waveguideC {"waveguideC"};
     static juce::String waveguideD {"waveguideD"};
+    static juce::String sendPreDelay1 {"sendPreDelay1"};
+    static juce::String sendPreDelay2 {"sendPreDelay2"};
+    static juce::String sendPreDelay3 {"sendPreDelay3"};
+
+    // ordered as PluginProcessor::ParameterIndex
+    static const juce::String* continuous[] {&dryWet, &blendReverbWaveguide, &wetGain, &roomSize, &rt60,
+        &waveguideA, &waveguideB, &waveguideC, &waveguideD, &sendPreDelay1, &sendPreDelay2, &sendPreDelay3};
+
+    // application settings
+    static juce::Identifier highQualityBounces {"highQualityBounces"};
+    static juce::Identifier adaptiveQuality {"adaptiveQuality"};
+
+    // gui properties
+    static juce::String highQualityBouncesToggle {"settings:highQualityBounces"};
+    static juce::String adaptiveQualityToggle {"settings:adaptiveQuality"};
+    static juce::String qualityTier {"governor:tier"};
+    static juce::String qualityTierName {"governor:tierName"};
 }
 
 juce::AudioProcessorValueTreeState::ParameterLayout createParameterLayout()
@@ -51,7 +69,8 @@ juce::AudioProcessorValueTreeState::ParameterLayout createParameterLayout()
     auto reverb = std::make_unique<juce::AudioProcessorParameterGroup>("Reverb", TRANS ("Reverb"), "|");
     reverb->addChild (std::make_unique<juce::AudioParameterFloat>(juce::ParameterID (IDs::lowPass, 1), "Low Pass", freqRange, 440.0f),
         std::make_unique<juce::AudioParameterFloat>(juce::ParameterID (IDs::roomSize, 1), "Room Size", juce::NormalisableRange<float>(50.0f, 300.0f, 5.0f), 150.0f),
-        std::make_unique<juce::AudioParameterFloat>(juce::ParameterID (IDs::rt60, 1), "RT 60", juce::NormalisableRange<float>(0.2f, 10.0f, 0.1f), 2.0f));
+        std::make_unique<juce::AudioParameterFloat>(juce::ParameterID (IDs::rt60, 1), "RT 60", juce::NormalisableRange<float>(0.2f, 10.0f, 0.1f), 2.0f),
+        std::make_unique<juce::AudioParameterBool>(juce::ParameterID (IDs::freeze, 1), "Freeze IR", false));
 
     auto waveguide = std::make_unique<juce::AudioProcessorParameterGroup>("Waveguide", TRANS ("Waveguide"), "|");
         waveguide->addChild (std::make_unique<juce::AudioParameterChoice>(juce::ParameterID (IDs::modelType, 1), "Model Type", juce::StringArray("None", "Plucked String"), 0),
@@ -62,7 +81,12 @@ juce::AudioProcessorValueTreeState::ParameterLayout createParameterLayout()
         std::make_unique<juce::AudioParameterFloat>(juce::ParameterID(IDs::waveguideC, 1), "Waveguide C", juce::NormalisableRange<float>(0.0f, 1.0f, 0.01f), 0.5f),
         std::make_unique<juce::AudioParameterFloat>(juce::ParameterID(IDs::waveguideD, 1), "Waveguide D", juce::NormalisableRange<float>(0.0f, 1.0f, 0.01f), 0.5f));
 
-    layout.add (std::move (global), std::move (reverb), std::move (waveguide));
+    auto sends = std::make_unique<juce::AudioProcessorParameterGroup>("Sends", TRANS ("Sends"), "|");
+    sends->addChild (std::make_unique<juce::AudioParameterFloat>(juce::ParameterID (IDs::sendPreDelay1, 1), "Send 1 Pre-Delay", juce::NormalisableRange<float>(0.0f, Colin::Input_Matrix::MAX_PRE_DELAY_MS, 1.0f), 0.0f),
+        std::make_unique<juce::AudioParameterFloat>(juce::ParameterID (IDs::sendPreDelay2, 1), "Send 2 Pre-Delay", juce::NormalisableRange<float>(0.0f, Colin::Input_Matrix::MAX_PRE_DELAY_MS, 1.0f), 0.0f),
+        std::make_unique<juce::AudioParameterFloat>(juce::ParameterID (IDs::sendPreDelay3, 1), "Send 3 Pre-Delay", juce::NormalisableRange<float>(0.0f, Colin::Input_Matrix::MAX_PRE_DELAY_MS, 1.0f), 0.0f));
+
+    layout.add (std::move (global), std::move (reverb), std::move (waveguide), std::move (sends));
 
     return layout;
 }
@@ -76,6 +100,10 @@ PluginProcessor::PluginProcessor()
                      #if ! JucePlugin_IsMidiEffect
                       #if ! JucePlugin_IsSynth
                        .withInput  ("Input",  juce::AudioChannelSet::stereo(), true)
+                       // other tracks' sends, sharing the one network with the main input
+                       .withInput  ("Send 1", juce::AudioChannelSet::stereo(), false)
+                       .withInput  ("Send 2", juce::AudioChannelSet::stereo(), false)
+                       .withInput  ("Send 3", juce::AudioChannelSet::stereo(), false)
                       #endif
                        .withOutput ("Output", juce::AudioChannelSet::stereo(), true)
                      #endif
@@ -85,34 +113,28 @@ PluginProcessor::PluginProcessor()
     FOLEYS_SET_SOURCE_PATH(__FILE__);
     magicState.setApplicationSettingsFile (juce::File::getSpecialLocation (juce::File::userDocumentsDirectory).getChildFile ("Colin's Plugins").getChildFile ("WaveguideReverb" + juce::String (".settings")));
 
-    // global params
-    dryWet = treeState.getRawParameterValue (IDs::dryWet);
-    jassert(dryWet != nullptr);
-    blendReverbWaveguide = treeState.getRawParameterValue(IDs::blendReverbWaveguide);
-    jassert(blendReverbWaveguide != nullptr);
-    wetGain = treeState.getRawParameterValue(IDs::wetGain);
-    jassert(wetGain != nullptr);
-
-    // reverb params
-    roomSize = treeState.getRawParameterValue (IDs::roomSize);
-    jassert(roomSize != nullptr);
-    rt60 = treeState.getRawParameterValue (IDs::rt60);
-    jassert(rt60 != nullptr);
-    lowPass = treeState.getRawParameterValue (IDs::lowPass);
-    jassert(lowPass != nullptr);
+    // continuous params, seeded with their current values so the first block applies everything
+    for(size_t i = 0; i < NumParameters; i++) {
+        const auto* value = treeState.getRawParameterValue (*IDs::continuous[i]);
+        jassert(value != nullptr);
+        parameters.store(i, value->load());
+        treeState.addParameterListener(*IDs::continuous[i], this);
+    }
+    parameters.markAll();
 
     // waveguide params
     treeState.addParameterListener(IDs::modelType, this);
     treeState.addParameterListener(IDs::rootNote, this);
     treeState.addParameterListener(IDs::chordType, this);
-    waveguideA = treeState.getRawParameterValue (IDs::waveguideA);
-    jassert(waveguideA != nullptr);
-    waveguideB = treeState.getRawParameterValue (IDs::waveguideB);
-    jassert(waveguideB != nullptr);
-    waveguideC = treeState.getRawParameterValue (IDs::waveguideC);
-    jassert(waveguideC != nullptr);
-    waveguideD = treeState.getRawParameterValue (IDs::waveguideD);
-    jassert(waveguideD != nullptr);
+    treeState.addParameterListener(IDs::freeze, this);
+    applyStructuralState();
+    startTimerHz(30);
+
+    // the lines are mapped in during prepare, so the first blocks and room size changes don't fault
+    waveVerb.setPrefault(true);
+   #if JUCE_DEBUG
+    waveVerb.setFaultMonitoring(true);
+   #endif
 
     magicState.setGuiValueTree(BinaryData::magic_xml, BinaryData::magic_xmlSize);
 
@@ -128,6 +150,18 @@ PluginProcessor::PluginProcessor()
     presetList->setPresetsNode(presetNode);
     //loadPresetInternal(0);
 
+    // per user, every instance bounces the same way
+    highQualityBounces.store (magicState.getSettings().getProperty (IDs::highQualityBounces, true));
+    adaptiveQuality.store (magicState.getSettings().getProperty (IDs::adaptiveQuality, false));
+    highQualityBouncesToggle.referTo (magicState.getPropertyAsValue (IDs::highQualityBouncesToggle));
+    highQualityBouncesToggle.setValue (highQualityBounces.load());
+    highQualityBouncesToggle.addListener (this);
+    adaptiveQualityToggle.referTo (magicState.getPropertyAsValue (IDs::adaptiveQualityToggle));
+    adaptiveQualityToggle.setValue (adaptiveQuality.load());
+    adaptiveQualityToggle.addListener (this);
+    magicState.getPropertyAsValue (IDs::qualityTier).setValue (0);
+    magicState.getPropertyAsValue (IDs::qualityTierName).setValue (Colin::getQualityTierName (Colin::Quality_Tier::Full));
+
 
     // can delete upon release
     formatManager.registerBasicFormats();
@@ -136,6 +170,7 @@ PluginProcessor::PluginProcessor()
 
 PluginProcessor::~PluginProcessor()
 {
+    stopTimer();
 }
 
 //==============================================================================
@@ -211,39 +246,216 @@ void PluginProcessor::changeProgramName (int index, const juce::String& newName)
 
 void PluginProcessor::parameterChanged (const juce::String& param, float value) {
     if(param == IDs::modelType) {
-        waveVerb.setModel(juce::roundToInt(value));
+        structural.store(ModelType, value);
     }
     else if(param == IDs::rootNote) {
-        waveVerb.setRoot(juce::roundToInt(value));
+        structural.store(RootNote, value);
     }
     else if(param == IDs::chordType) {
-        waveVerb.setChord(juce::roundToInt(value));
+        structural.store(ChordType, value);
+    }
+    else if(param == IDs::freeze) {
+        freezeRequested.store(value > 0.5f);
+    }
+    else {
+        for(size_t i = 0; i < NumParameters; i++) {
+            if(param == *IDs::continuous[i]) {
+                parameters.store(i, value);
+                return;
+            }
+        }
+    }
+}
+
+void PluginProcessor::timerCallback()
+{
+    // the governor's tier changes on the audio thread, the gui follows it from here
+    const auto tier = waveVerb.getQualityTier();
+    if (tier != shownTier)
+    {
+        shownTier = tier;
+        magicState.getPropertyAsValue (IDs::qualityTier).setValue (static_cast<int> (tier));
+        magicState.getPropertyAsValue (IDs::qualityTierName).setValue (Colin::getQualityTierName (tier));
+    }
+
+    const bool freeze = freezeRequested.load();
+    if(freeze != freezeApplied) {
+        freezeApplied = freeze;
+        waveVerb.setFreeze(freeze);
     }
 }
 
+void PluginProcessor::applyStructuralChanges()
+{
+    const uint32_t changed = structural.takeChanged();
+    if(changed == 0) return;
+
+    using Mask = decltype(structural);
+    if(changed & Mask::bit(ModelType))
+        waveVerb.setModel(juce::roundToInt(structural.get(ModelType)));
+    if(changed & Mask::bit(RootNote))
+        waveVerb.setRoot(juce::roundToInt(structural.get(RootNote)));
+    if(changed & Mask::bit(ChordType))
+        waveVerb.setChord(juce::roundToInt(structural.get(ChordType)));
+}
+
+void PluginProcessor::applyStructuralState()
+{
+    {
+        // a host can load a state mid playback, processBlock waits for the callback lock meanwhile
+        const juce::ScopedLock lock (getCallbackLock());
+        structural.store(ModelType, treeState.getRawParameterValue(IDs::modelType)->load());
+        structural.store(RootNote, treeState.getRawParameterValue(IDs::rootNote)->load());
+        structural.store(ChordType, treeState.getRawParameterValue(IDs::chordType)->load());
+        structural.markAll();
+        applyStructuralChanges();
+    }
+    freezeRequested.store(treeState.getRawParameterValue(IDs::freeze)->load() > 0.5f);
+    freezeApplied = freezeRequested.load();
+    waveVerb.setFreeze(freezeApplied);
+}
+
+void PluginProcessor::postSetStateInformation()
+{
+    applyStructuralState();
+}
+
+void PluginProcessor::applyParameterChanges()
+{
+    const uint32_t changed = parameters.takeChanged();
+    if(changed == 0) return;
+
+    using Mask = decltype(parameters);
+    if(changed & (Mask::bit(RoomSize) | Mask::bit(RT60)))
+        waveVerb.setSize(parameters.get(RoomSize), parameters.get(RT60));
+    if(changed & Mask::bit(DryWet))
+        waveVerb.setDryWet(parameters.get(DryWet));
+    if(changed & Mask::bit(WetGain))
+        waveVerb.setOutputGain(parameters.get(WetGain));
+    if(changed & Mask::bit(Blend))
+        waveVerb.setBlend(parameters.get(Blend));
+    if(changed & Mask::bit(WaveguideA))
+        waveVerb.setWaveguideRate(parameters.get(WaveguideA));
+    if(changed & Mask::bit(WaveguideB))
+        waveVerb.setWaveguideDecay(parameters.get(WaveguideB));
+    if(changed & Mask::bit(WaveguideC))
+        waveVerb.setWaveguideTrigger(parameters.get(WaveguideC));
+    if(changed & Mask::bit(WaveguideD))
+        waveVerb.setWaveguidePickup(parameters.get(WaveguideD));
+    for(int send = 0; send < NumSends; send++)
+        if(changed & Mask::bit(static_cast<size_t>(SendPreDelay1 + send)))
+            waveVerb.setSendPreDelay(send + 1, parameters.get(static_cast<size_t>(SendPreDelay1 + send)));
+}
+
 void PluginProcessor::prepareToPlay (double sampleRate, int samplesPerBlock)
 {
     juce::ignoreUnused (sampleRate, samplesPerBlock);
 
     magicState.prepareToPlay (sampleRate, samplesPerBlock);
-    waveVerb.prepareToPlay(sampleRate);
+    // the whole profile, multirate and pipelining included, setNonRealtime only switches the rest
+    waveVerb.setRenderProfile (chooseRenderProfile (isNonRealtime()));
+    // bounces have no deadline and have to sound the same every time
+    waveVerb.setLoadGovernor (adaptiveQuality.load() && ! isNonRealtime());
+    waveVerb.setChannelLayout (getMainBusNumInputChannels(), getMainBusNumOutputChannels());
+    waveVerb.setOutputLayout (getChannelLayoutOfBus (false, 0));
+    // the aux inputs are the sends, a disabled one is turned off
+    for (int bus = 1; bus <= NumSends; bus++)
+    {
+        const int channels = bus < getBusCount (true) ? getChannelCountOfBus (true, bus) : 0;
+        waveVerb.setSendBus (bus, channels > 0 ? getChannelIndexInProcessBlockBuffer (true, bus, 0) : 0, channels);
+    }
+    // the engine starts on the current model and tuning rather than catching up a block later
+    applyStructuralState();
+    // only clears state if the rate and block size are the same as last time
+    waveVerb.prepareToPlay(sampleRate, samplesPerBlock);
 
     // can delete upon release
     transport.prepareToPlay(samplesPerBlock, sampleRate);
-    juce::File loop (juce::File::getSpecialLocation(juce::File::SpecialLocationType::userMusicDirectory).getChildFile("test_guitar_loop.wav"));
-    juce::AudioFormatReader* reader = formatManager.createReaderFor(loop);
-    std::unique_ptr<juce::AudioFormatReaderSource> tempSource (new juce::AudioFormatReaderSource (reader, true));
-    tempSource->setLooping(true);
-    transport.setSource(tempSource.get());
-    playSource.reset(tempSource.release());
+    if (playSource == nullptr)
+    {
+        // the test loop is read from disk once, later prepares keep the open reader
+        juce::File loop (juce::File::getSpecialLocation(juce::File::SpecialLocationType::userMusicDirectory).getChildFile("test_guitar_loop.wav"));
+        if (juce::AudioFormatReader* reader = formatManager.createReaderFor(loop))
+        {
+            std::unique_ptr<juce::AudioFormatReaderSource> tempSource (new juce::AudioFormatReaderSource (reader, true));
+            tempSource->setLooping(true);
+            transport.setSource(tempSource.get());
+            playSource.reset(tempSource.release());
+        }
+    }
     transport.setPosition (0.0);
     isPlaying = false;
 }
 
 void PluginProcessor::releaseResources()
 {
-    // When playback stops, you can use this as an opportunity to free up any
-    // spare memory, etc.
+    // suspended and frozen tracks give their delay lines back, prepareToPlay takes memory again
+    const size_t reclaimed = waveVerb.releaseResources();
+    reclaimedBytes.store (reclaimed);
+
+    // can delete upon release
+    transport.releaseResources();
+}
+
+size_t PluginProcessor::getReclaimedMemory() const
+{
+    return reclaimedBytes.load();
+}
+
+Colin::Render_Profile PluginProcessor::chooseRenderProfile (bool nonRealtime) const
+{
+    auto profile = Colin::Render_Profile::live();
+    if (nonRealtime)
+    {
+        if (highQualityBounces.load())
+            profile = Colin::Render_Profile::bounce();
+        else
+            profile.pipelining = true; // same output, just spread over more cores
+    }
+    return profile;
+}
+
+void PluginProcessor::setNonRealtime (bool nonRealtime) noexcept
+{
+    foleys::MagicProcessor::setNonRealtime (nonRealtime);
+    waveVerb.switchRenderProfile (chooseRenderProfile (nonRealtime));
+    // bounces have no deadline and have to sound the same every time
+    waveVerb.setLoadGovernor (adaptiveQuality.load() && ! nonRealtime);
+}
+
+void PluginProcessor::setHighQualityBounces (bool shouldUseBounceProfile)
+{
+    highQualityBounces.store (shouldUseBounceProfile);
+    magicState.getSettings().setProperty (IDs::highQualityBounces, shouldUseBounceProfile, nullptr);
+    highQualityBouncesToggle.setValue (shouldUseBounceProfile);
+    if (isNonRealtime())
+        waveVerb.switchRenderProfile (chooseRenderProfile (true));
+}
+
+bool PluginProcessor::getHighQualityBounces() const
+{
+    return highQualityBounces.load();
+}
+
+void PluginProcessor::setAdaptiveQuality (bool shouldGovern)
+{
+    adaptiveQuality.store (shouldGovern);
+    magicState.getSettings().setProperty (IDs::adaptiveQuality, shouldGovern, nullptr);
+    adaptiveQualityToggle.setValue (shouldGovern);
+    waveVerb.setLoadGovernor (shouldGovern && ! isNonRealtime());
+}
+
+bool PluginProcessor::getAdaptiveQuality() const
+{
+    return adaptiveQuality.load();
+}
+
+void PluginProcessor::valueChanged (juce::Value& value)
+{
+    if (value.refersToSameSourceAs (highQualityBouncesToggle))
+        setHighQualityBounces (static_cast<bool> (value.getValue()));
+    else if (value.refersToSameSourceAs (adaptiveQualityToggle))
+        setAdaptiveQuality (static_cast<bool> (value.getValue()));
 }
 
 bool PluginProcessor::isBusesLayoutSupported (const BusesLayout& layouts) const
@@ -252,16 +464,30 @@ bool PluginProcessor::isBusesLayoutSupported (const BusesLayout& layouts) const
     juce::ignoreUnused (layouts);
     return true;
   #else
-    // This is the place where you check if the layout is supported.
-    // In this template code we only support mono or stereo.
-    if (layouts.getMainOutputChannelSet() != juce::AudioChannelSet::mono()
-     && layouts.getMainOutputChannelSet() != juce::AudioChannelSet::stereo())
+    // mono and stereo on either side, mono sends into a stereo return included,
+    // the engine has its own path for each combination
+    const auto isMonoOrStereo = [] (const juce::AudioChannelSet& set)
+    {
+        return set == juce::AudioChannelSet::mono() || set == juce::AudioChannelSet::stereo();
+    };
+    // surround and ambisonic outputs get the network decoded to them, fed from
+    // a mono or stereo send or from the same layout
+    const auto& output = layouts.getMainOutputChannelSet();
+    const bool decoded = Colin::Output_Decoder::supports (output);
+    if (! isMonoOrStereo (output) && ! decoded)
         return false;
 
-    // This checks if the input layout matches the output layout
    #if ! JucePlugin_IsSynth
-    if (layouts.getMainOutputChannelSet() != layouts.getMainInputChannelSet())
+    const auto& input = layouts.getMainInputChannelSet();
+    if (! isMonoOrStereo (input) && ! (decoded && input == output))
         return false;
+
+    for (int bus = 1; bus < layouts.inputBuses.size(); bus++)
+    {
+        const auto& send = layouts.getChannelSet (true, bus);
+        if (! send.isDisabled() && ! isMonoOrStereo (send))
+            return false;
+    }
    #endif
 
     return true;
@@ -284,20 +510,13 @@ void PluginProcessor::processBlock (juce::AudioBuffer<float>& buffer,
     //juce::AudioSourceChannelInfo sourceInfo(buffer);
     //transport.getNextAudioBlock(sourceInfo);
 
-    waveVerb.setSize(*roomSize, *rt60);
-    waveVerb.setDryWet(*dryWet);
-    waveVerb.setOutputGain(*wetGain);
-    waveVerb.setBlend(*blendReverbWaveguide);
-    waveVerb.setWaveguideRate(*waveguideA);
-    waveVerb.setWaveguideDecay(*waveguideB);
-    waveVerb.setWaveguideTrigger(*waveguideC);
-    waveVerb.setWaveguidePickup(*waveguideD);
-    if(!midiMessages.isEmpty()) {
-        waveVerb.processMidi(midiMessages);
+    applyStructuralChanges();
+    applyParameterChanges();
+    if(parameters.get(DryWet) != 0.f) {
+        waveVerb.processBuffer(buffer, midiMessages);
     }
-
-    if(*dryWet != 0.f) {
-        waveVerb.processBuffer(buffer);
+    else if(!midiMessages.isEmpty()) {
+        waveVerb.processMidi(midiMessages);
     }
 
     if(newPreset != -1) {
@@ -11,7 +11,9 @@
 class PresetListBox;
 
 class PluginProcessor : public foleys::MagicProcessor,
-    private juce::AudioProcessorValueTreeState::Listener
+    private juce::AudioProcessorValueTreeState::Listener,
+    private juce::Value::Listener,
+    private juce::Timer
 {
 public:
 
@@ -23,6 +25,10 @@ public:
 
     bool isBusesLayoutSupported (const BusesLayout& layouts) const override;
 
+    /// switches the engine's pruning, update budget and governor right away, multirate and
+    /// pipelining only change in prepareToPlay, which hosts don't have to call around a bounce
+    void setNonRealtime (bool nonRealtime) noexcept override;
+
     void processBlock (juce::AudioBuffer<float>&, juce::MidiBuffer&) override;
 
     const juce::String getName() const override;
@@ -43,25 +49,79 @@ public:
     void savePresetInternal();
     void loadPresetInternal(int index);
 
+    /// bytes the engine gave up in the last releaseResources()
+    size_t getReclaimedMemory() const;
+
+    /// message thread, whether offline renders use Render_Profile::bounce() or the live profile,
+    /// saved with the user's settings and toggled from the gui's settings tab, a bounce that is
+    /// already running switches what it can right away and the rest at the next prepareToPlay
+    void setHighQualityBounces (bool shouldUseBounceProfile);
+    bool getHighQualityBounces() const;
+
+    /// message thread, opt in, live playback steps down through Colin::Quality_Tier when the
+    /// engine gets close to its deadline, toggled from the gui's settings tab, the tier is shown
+    /// through the "governor:tier" and "governor:tierName" properties
+    void setAdaptiveQuality (bool shouldGovern);
+    bool getAdaptiveQuality() const;
+
 private:
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PluginProcessor)
 
-    std::atomic<float>* dryWet = nullptr;
-    std::atomic<float>* blendReverbWaveguide = nullptr;
-    std::atomic<float>* wetGain = nullptr;
-    std::atomic<float>* roomSize = nullptr;
-    std::atomic<float>* rt60 = nullptr;
-    std::atomic<float>* lowPass = nullptr;
-    std::atomic<float>* waveguideA = nullptr;
-    std::atomic<float>* waveguideB = nullptr;
-    std::atomic<float>* waveguideC = nullptr;
-    std::atomic<float>* waveguideD = nullptr;
+    // continuous parameters are pushed by the listener and applied on the audio thread
+    enum ParameterIndex {
+        DryWet = 0,
+        Blend,
+        WetGain,
+        RoomSize,
+        RT60,
+        WaveguideA,
+        WaveguideB,
+        WaveguideC,
+        WaveguideD,
+        SendPreDelay1,
+        SendPreDelay2,
+        SendPreDelay3,
+        NumParameters
+    };
+    static constexpr int NumSends = 3; /// aux input buses, one pre-delay parameter each
+    Colin::Dirty_Mask<NumParameters> parameters;
+    void applyParameterChanges();
+
+    // structural parameters are picked up at the start of the next block, root and chord only
+    // choose between the tunings the engine built in prepareToPlay
+    enum StructuralIndex {
+        ModelType = 0,
+        RootNote,
+        ChordType,
+        NumStructural
+    };
+    Colin::Dirty_Mask<NumStructural> structural;
+    void applyStructuralChanges();
+    /// message thread, the parameters' current values straight into the engine, from prepareToPlay and after a state load
+    void applyStructuralState();
+    void postSetStateInformation() override;
+
+    // freezing builds its renderer the first time, so the timer applies it from the message thread
+    std::atomic<bool> freezeRequested {false};
+    bool freezeApplied = false;
+    void timerCallback() override;
+
+    Colin::Render_Profile chooseRenderProfile (bool nonRealtime) const;
+
+    // settings toggled from the gui, mirrored into the user's settings file
+    juce::Value highQualityBouncesToggle;
+    juce::Value adaptiveQualityToggle;
+    void valueChanged (juce::Value& value) override;
 
     juce::AudioProcessorValueTreeState treeState {*this, nullptr};
     juce::ValueTree presetNode;
     PresetListBox* presetList = nullptr;
 
     Colin::WaveVerb waveVerb;
+    std::atomic<size_t> reclaimedBytes {0};
+    std::atomic<bool> highQualityBounces {true};
+    std::atomic<bool> adaptiveQuality {false};
+    Colin::Quality_Tier shownTier = Colin::Quality_Tier::Full;
     int newPreset = -1;
 
 
@@ -0,0 +1,75 @@
+#include "helpers/test_helpers.h"
+#include <catch2/catch_test_macros.hpp>
+
+using Colin::Buffer_Pool;
+using Colin::WaveVerb;
+
+TEST_CASE ("Buffer pool hands released storage back warm", "[pool]")
+{
+    Buffer_Pool<float> pool;
+    auto first = pool.acquire (1000);
+    CHECK (first.capacity() >= 1000);
+    CHECK (pool.getColdCount() == 1);
+
+    first.resize (1000, 1.f);
+    const float* storage = first.data();
+    pool.release (std::move (first));
+    CHECK (pool.getPooledBytes() >= 1000 * sizeof (float));
+
+    // too big a waste for a small request
+    auto small = pool.acquire (100);
+    CHECK (small.data() != storage);
+
+    auto again = pool.acquire (900);
+    CHECK (again.data() == storage);
+    CHECK (again.empty());
+    CHECK (pool.getWarmCount() == 1);
+    CHECK (pool.getPooledBytes() == 0);
+}
+
+TEST_CASE ("Buffer pool stays under its limit", "[pool]")
+{
+    Buffer_Pool<float> pool;
+    pool.setLimit (2500 * sizeof (float));
+    for (int i = 0; i < 3; i++)
+        pool.release (pool.acquire (1000));
+    CHECK (pool.getPooledBytes() <= pool.getLimit());
+    CHECK (pool.getPooledBytes() > 0);
+
+    pool.release (pool.acquire (10000));
+    CHECK (pool.getPooledBytes() <= pool.getLimit());
+
+    pool.clear();
+    CHECK (pool.getPooledBytes() == 0);
+}
+
+TEST_CASE ("Released engines give their lines back and prepare again from the pool", "[pool]")
+{
+    juce::SharedResourcePointer<Buffer_Pool<Colin::Line_Storage::Stored>> pool;
+    WaveVerb verb;
+    verb.setPoolLimit (64u << 20);
+    verb.prepareToPlay (48000.0);
+    const auto prepared = verb.getMemoryUsage().total();
+
+    const auto reclaimed = verb.releaseResources();
+    CHECK (reclaimed > prepared * 9 / 10);
+    CHECK (verb.getMemoryUsage().total() == prepared - reclaimed);
+    CHECK (verb.getProcessMemoryUsage() >= verb.getMemoryUsage().total());
+    CHECK (verb.getPooledMemory() > 0);
+
+    const auto warmBefore = pool->getWarmCount();
+    verb.prepareToPlay (48000.0);
+    CHECK (verb.getMemoryUsage().total() == prepared);
+    CHECK (pool->getWarmCount() > warmBefore);
+
+    // still a working reverb
+    verb.setDryWet (100.f);
+    const auto out = renderBlocks (verb, 2, 512, 21, [] (juce::AudioBuffer<float>& buffer, int block)
+    {
+        if (block == 0)
+            buffer.setSample (0, 0, 1.f);
+    });
+    CHECK (energy (out[0]) > 0.0);
+    CHECK (allFinite (out[0]));
+    verb.setPoolLimit (Buffer_Pool<float>::DEFAULT_LIMIT);
+}
@@ -0,0 +1,118 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/matchers/catch_matchers_floating_point.hpp>
+#include "waveguide_reverb/waveguide_reverb.h"
+
+using Catch::Matchers::WithinAbs;
+using Catch::Matchers::WithinRel;
+using Colin::Basic_Circular_Buffer;
+
+template <typename Storage>
+static float roundTrip (float x)
+{
+    return Storage::decode (Storage::encode (x));
+}
+
+// a noise burst into a comb filter with a 2 second rt60, returns the tail
+template <typename Storage>
+static std::vector<float> combTail (int length)
+{
+    const double fs = 48000.0;
+    const int delay = 1931; // about 40 ms
+    const float feedback = std::pow (10.f, -3.f * static_cast<float> (delay) / (2.f * static_cast<float> (fs)));
+    Basic_Circular_Buffer<Storage> line (delay);
+    line.reset();
+
+    std::vector<float> out (static_cast<size_t> (length));
+    uint32_t rng = 1;
+    for (int i = 0; i < length; i++)
+    {
+        rng = rng * 1664525u + 1013904223u;
+        const float in = i < 4800 ? static_cast<float> (rng >> 9) / 8388608.f - 1.f : 0.f;
+        const float y = line.getBack();
+        line.add (in + feedback * y);
+        out[static_cast<size_t> (i)] = y;
+    }
+    return out;
+}
+
+// worst ratio of tail to error over 100 ms windows, until the tail is 100 dB down
+template <typename Storage>
+static float worstTailToErrorDb()
+{
+    const int length = 48000 * 4;
+    const auto reference = combTail<Colin::Float_Storage> (length);
+    const auto reduced = combTail<Storage> (length);
+    const int window = 4800;
+    float worst = 1000.f;
+    double peak = 0.0;
+    for (int start = window; start + window <= length; start += window)
+    {
+        double signal = 0.0, error = 0.0;
+        for (int i = start; i < start + window; i++)
+        {
+            const double d = reduced[static_cast<size_t> (i)] - reference[static_cast<size_t> (i)];
+            signal += reference[static_cast<size_t> (i)] * reference[static_cast<size_t> (i)];
+            error += d * d;
+        }
+        peak = std::max (peak, signal);
+        if (signal < peak * 1.0e-10)
+            break;
+        worst = std::min (worst, static_cast<float> (10.0 * std::log10 (signal / std::max (error, 1.0e-30))));
+    }
+    return worst;
+}
+
+TEST_CASE ("Half floats round trip and saturate", "[storage]")
+{
+    using Colin::Half_Storage;
+    CHECK (roundTrip<Half_Storage> (0.f) == 0.f);
+    CHECK (roundTrip<Half_Storage> (0.5f) == 0.5f);
+    CHECK (roundTrip<Half_Storage> (-1.25f) == -1.25f);
+    CHECK (roundTrip<Half_Storage> (6.103515625e-05f) == 6.103515625e-05f); // smallest normal
+    CHECK (roundTrip<Half_Storage> (5.9604645e-08f) == 5.9604645e-08f);     // smallest subnormal
+    CHECK (roundTrip<Half_Storage> (1.0e6f) == 65504.f);
+    CHECK (roundTrip<Half_Storage> (-1.0e6f) == -65504.f);
+    for (float x = 1.0e-4f; x < 100.f; x *= 1.37f)
+        CHECK_THAT (roundTrip<Half_Storage> (x), WithinRel (x, 1.f / 2048.f));
+}
+
+TEST_CASE ("Int16 keeps its precision", "[storage]")
+{
+    using Colin::Int16_Storage;
+    const float step = Int16_Storage::FULL_SCALE / 32767.f;
+    CHECK (roundTrip<Int16_Storage> (0.f) == 0.f);
+    CHECK (roundTrip<Int16_Storage> (100.f) == Int16_Storage::FULL_SCALE);
+    for (float x = -3.9f; x < 3.9f; x += 0.0123f)
+        CHECK_THAT (roundTrip<Int16_Storage> (x), WithinAbs (x, 0.5f * step));
+}
+
+TEST_CASE ("Reduced precision leaves the decaying tail alone", "[storage]")
+{
+    // the error of the floating formats is relative, so it decays with the tail
+    const float half = worstTailToErrorDb<Colin::Half_Storage>();
+    WARN ("tail to error, half " << half << " dB");
+    CHECK (half > 45.f);
+}
+
+TEST_CASE ("Int16 diffusion lines stay below -85 dBFS", "[storage]")
+{
+    // no feedback, so the quantisation noise is a fixed floor under the signal
+    Colin::Basic_Single_Delay<Colin::Int16_Storage> reduced;
+    Colin::Basic_Single_Delay<Colin::Float_Storage> reference;
+    reduced.prepareToPlay (48000.0, 0.01f, 1.f, false);
+    reference.prepareToPlay (48000.0, 0.01f, 1.f, false);
+
+    double error = 0.0;
+    const int length = 48000;
+    for (int i = 0; i < length; i++)
+    {
+        const float in = 0.5f * std::sin (0.0123f * static_cast<float> (i)) * std::exp (-0.0001f * static_cast<float> (i));
+        reduced.delay (in);
+        reference.delay (in);
+        const float d = reduced.get() - reference.get();
+        error += d * d;
+    }
+    const float floorDb = static_cast<float> (10.0 * std::log10 (error / length));
+    WARN ("int16 noise floor " << floorDb << " dBFS");
+    CHECK (floorDb < -85.f);
+}
@@ -0,0 +1,66 @@
+#include <catch2/catch_test_macros.hpp>
+#include <cmath>
+#include "waveguide_reverb/waveguide_reverb.h"
+
+using Colin::data;
+using Colin::NUM_CHANNELS;
+
+namespace
+{
+    data ramp (float start, float step)
+    {
+        data d;
+        for (int i = 0; i < NUM_CHANNELS; i++)
+            d.channels[i] = start + step * static_cast<float> (i);
+        return d;
+    }
+}
+
+TEST_CASE ("Frame expressions match the per channel loops", "[frame]")
+{
+    static_assert (alignof (data) == 64);
+    static_assert (sizeof (data) == 64);
+
+    const data a = ramp (-1.f, 0.125f);
+    const data b = ramp (0.5f, -0.0625f);
+    float lfo[NUM_CHANNELS];
+    for (int i = 0; i < NUM_CHANNELS; i++)
+        lfo[i] = 1.f + 0.001f * static_cast<float> (i);
+
+    const data sum = a + b * 0.5f - b;
+    const data product = Colin::multiplyAdd (a, b, Colin::lanes (lfo));
+    for (int i = 0; i < NUM_CHANNELS; i++)
+    {
+        CHECK (sum.channels[i] == a.channels[i] + b.channels[i] * 0.5f - b.channels[i]);
+        CHECK (product.channels[i] == a.channels[i] * b.channels[i] + lfo[i]);
+    }
+
+    // the feedback write, against the householder written out
+    float total = 0.f;
+    for (int i = 0; i < NUM_CHANNELS; i++)
+        total += a.channels[i];
+    const data written = b + Colin::householder (a) * 0.85f * Colin::lanes (lfo);
+    for (int i = 0; i < NUM_CHANNELS; i++)
+    {
+        const float reflected = a.channels[i] - total * (2.f / NUM_CHANNELS);
+        CHECK (std::abs (written.channels[i] - (b.channels[i] + reflected * 0.85f * lfo[i])) < 1.0e-6f);
+    }
+
+    // householder keeps the energy
+    const data mixed = Colin::householder (a + b);
+    float before = 0.f, after = 0.f;
+    for (int i = 0; i < NUM_CHANNELS; i++)
+    {
+        const float in = a.channels[i] + b.channels[i];
+        before += in * in;
+        after += mixed.channels[i] * mixed.channels[i];
+    }
+    CHECK (std::abs (before - after) < 1.0e-4f);
+
+    // assigning an expression that reads the frame it writes
+    data blended = a;
+    Colin::Mix_Matrix matrix;
+    blended = matrix.intermix (blended, b, 0.25f, 0.75f);
+    for (int i = 0; i < NUM_CHANNELS; i++)
+        CHECK (blended.channels[i] == 0.25f * a.channels[i] + 0.75f * b.channels[i]);
+}
@@ -0,0 +1,102 @@
+#include <catch2/catch_test_macros.hpp>
+#include <cmath>
+#include "waveguide_reverb/waveguide_reverb.h"
+
+using Colin::IO_Layout;
+using Colin::WaveVerb;
+
+namespace
+{
+    void prepare (WaveVerb& verb, int inputs, int outputs)
+    {
+        verb.setChannelLayout (inputs, outputs);
+        verb.prepareToPlay (48000.0, 256);
+        verb.setDryWet (50.f);
+    }
+
+    /// noise on the given channels, the same every block for the same seed and block
+    void fill (juce::AudioBuffer<float>& buffer, int block, const std::initializer_list<float> gains)
+    {
+        juce::Random random (block);
+        for (int i = 0; i < buffer.getNumSamples(); i++)
+        {
+            const float noise = random.nextFloat() * 0.2f - 0.1f;
+            int channel = 0;
+            for (const float gain : gains)
+                buffer.setSample (channel++, i, noise * gain);
+        }
+    }
+}
+
+TEST_CASE ("Each channel configuration gets its own path", "[io]")
+{
+    WaveVerb verb;
+    prepare (verb, 1, 1);
+    CHECK (verb.getIOLayout() == IO_Layout::Mono);
+    prepare (verb, 1, 2);
+    CHECK (verb.getIOLayout() == IO_Layout::Mono_To_Stereo);
+    prepare (verb, 2, 2);
+    CHECK (verb.getIOLayout() == IO_Layout::Stereo);
+    prepare (verb, 4, 6);
+    CHECK (verb.getIOLayout() == IO_Layout::Multichannel);
+}
+
+TEST_CASE ("A mono input sounds like left and inverted right", "[io]")
+{
+    WaveVerb stereo, mono, pipelined, monoToStereo, narrow;
+    prepare (stereo, 2, 2);
+    prepare (mono, 1, 1);
+    pipelined.setPipelining (true);
+    prepare (pipelined, 1, 1);
+    prepare (monoToStereo, 1, 2);
+    // prepared for stereo, a mono buffer only gets its own channel touched
+    prepare (narrow, 2, 2);
+
+    juce::AudioBuffer<float> a (2, 256), b (1, 256), c (2, 256), d (1, 256), e (1, 256);
+    bool finite = true;
+    for (int block = 0; block < 40; block++)
+    {
+        fill (a, block, { 1.f, -1.f });
+        fill (b, block, { 1.f });
+        fill (c, block, { 1.f, 5.f }); // the second channel isn't an input
+        fill (d, block, { 1.f });
+        fill (e, block, { 1.f });
+        stereo.processBuffer (a);
+        mono.processBuffer (b);
+        monoToStereo.processBuffer (c);
+        narrow.processBuffer (d);
+        pipelined.processBuffer (e);
+        for (int i = 0; i < 256; i++)
+        {
+            REQUIRE (b.getSample (0, i) == a.getSample (0, i));
+            REQUIRE (c.getSample (0, i) == a.getSample (0, i));
+            REQUIRE (d.getSample (0, i) == a.getSample (0, i));
+            REQUIRE (e.getSample (0, i) == a.getSample (0, i));
+            finite = finite && std::isfinite (c.getSample (1, i));
+        }
+    }
+    CHECK (finite);
+}
+
+TEST_CASE ("Extra channels fold onto the two sides", "[io]")
+{
+    WaveVerb stereo, quad;
+    prepare (stereo, 2, 2);
+    prepare (quad, 4, 4);
+
+    juce::AudioBuffer<float> a (2, 256), b (4, 256);
+    float difference = 0.f;
+    for (int block = 0; block < 40; block++)
+    {
+        fill (a, block, { 1.f, 0.5f });
+        fill (b, block, { 1.f, 0.5f, 1.f, 0.5f });
+        stereo.processBuffer (a);
+        quad.processBuffer (b);
+        for (int i = 0; i < 256; i++)
+        {
+            for (int channel = 0; channel < 4; channel++)
+                difference = std::max (difference, std::abs (b.getSample (channel, i) - a.getSample (channel % 2, i)));
+        }
+    }
+    CHECK (difference < 1.0e-6f);
+}
@@ -0,0 +1,119 @@
+#include <catch2/catch_test_macros.hpp>
+#include "waveguide_reverb/waveguide_reverb.h"
+#include <cstring>
+
+using Colin::Engine_Snapshot;
+using Colin::IR_Cache;
+using Colin::IR_Key;
+
+static juce::File makeCacheDirectory()
+{
+    auto directory = juce::File::getSpecialLocation (juce::File::tempDirectory).getChildFile ("WaveVerb IR Cache Test");
+    directory.deleteRecursively();
+    return directory;
+}
+
+static Engine_Snapshot makeSnapshot (float rt60MS)
+{
+    Engine_Snapshot snapshot;
+    snapshot.sampleRate = 48000.0;
+    snapshot.roomSizeMS = 60.f;
+    snapshot.rt60MS = rt60MS;
+    snapshot.blend = 0.5f;
+    snapshot.seed = 7;
+    return snapshot;
+}
+
+static void fillResponse (juce::AudioBuffer<float>& fromLeft, juce::AudioBuffer<float>& fromRight, int length)
+{
+    fromLeft.setSize (2, length);
+    fromRight.setSize (2, length);
+    for (int i = 0; i < length; i++)
+    {
+        fromLeft.setSample (0, i, static_cast<float> (i));
+        fromLeft.setSample (1, i, static_cast<float> (-i));
+        fromRight.setSample (0, i, 0.5f * static_cast<float> (i));
+        fromRight.setSample (1, i, static_cast<float> (length - i));
+    }
+}
+
+TEST_CASE ("IR key quantises inaudible differences away", "[ircache]")
+{
+    CHECK (IR_Key::from (makeSnapshot (2000.f)) == IR_Key::from (makeSnapshot (2000.2f)));
+    CHECK (IR_Key::from (makeSnapshot (2000.f)).hash() == IR_Key::from (makeSnapshot (2000.2f)).hash());
+    CHECK_FALSE (IR_Key::from (makeSnapshot (2000.f)) == IR_Key::from (makeSnapshot (2010.f)));
+    CHECK (IR_Key::from (makeSnapshot (2000.f)).hash() != IR_Key::from (makeSnapshot (2010.f)).hash());
+}
+
+TEST_CASE ("IR cache round trips a response", "[ircache]")
+{
+    IR_Cache cache;
+    cache.setDirectory (makeCacheDirectory());
+
+    juce::AudioBuffer<float> left, right;
+    fillResponse (left, right, 1000);
+    REQUIRE (cache.store (makeSnapshot (2000.f), left, right));
+
+    juce::AudioBuffer<float> loadedLeft, loadedRight;
+    REQUIRE (cache.load (makeSnapshot (2000.f), loadedLeft, loadedRight));
+    REQUIRE (loadedLeft.getNumSamples() == 1000);
+    REQUIRE (loadedRight.getNumSamples() == 1000);
+    for (int i = 0; i < 1000; i += 111)
+    {
+        CHECK (loadedLeft.getSample (0, i) == left.getSample (0, i));
+        CHECK (loadedLeft.getSample (1, i) == left.getSample (1, i));
+        CHECK (loadedRight.getSample (0, i) == right.getSample (0, i));
+        CHECK (loadedRight.getSample (1, i) == right.getSample (1, i));
+    }
+
+    // nothing stored for this one
+    CHECK_FALSE (cache.load (makeSnapshot (3000.f), loadedLeft, loadedRight));
+
+    // one rendered by another build is rejected and removed
+    const auto file = cache.getFile (IR_Key::from (makeSnapshot (2000.f)));
+    {
+        juce::MemoryBlock data;
+        REQUIRE (file.loadFileAsData (data));
+        Colin::IR_File_Header header;
+        std::memcpy (&header, data.getData(), sizeof (header));
+        header.key.render = (IR_Key::RENDER_VERSION - 1) << 8 | static_cast<uint32_t> (COLIN_DELAY_PRECISION);
+        data.copyFrom (&header, 0, sizeof (header));
+        REQUIRE (file.replaceWithData (data.getData(), data.getSize()));
+    }
+    CHECK_FALSE (cache.load (makeSnapshot (2000.f), loadedLeft, loadedRight));
+    CHECK_FALSE (file.exists());
+
+    // a truncated file is rejected and removed
+    file.replaceWithData ("WVIR", 4);
+    CHECK_FALSE (cache.load (makeSnapshot (2000.f), loadedLeft, loadedRight));
+    CHECK_FALSE (file.exists());
+
+    cache.getDirectory().deleteRecursively();
+}
+
+TEST_CASE ("IR cache evicts the least recently used response", "[ircache]")
+{
+    IR_Cache cache;
+    cache.setDirectory (makeCacheDirectory());
+
+    juce::AudioBuffer<float> left, right;
+    fillResponse (left, right, 4096);
+    REQUIRE (cache.store (makeSnapshot (1000.f), left, right));
+    REQUIRE (cache.store (makeSnapshot (2000.f), left, right));
+    const auto fileSize = cache.getFile (IR_Key::from (makeSnapshot (1000.f))).getSize();
+
+    // the first one is used again, so the second is now the oldest
+    cache.getFile (IR_Key::from (makeSnapshot (2000.f))).setLastModificationTime (juce::Time (1000));
+    juce::AudioBuffer<float> loadedLeft, loadedRight;
+    REQUIRE (cache.load (makeSnapshot (1000.f), loadedLeft, loadedRight));
+
+    cache.setSizeLimit (2 * fileSize);
+    REQUIRE (cache.store (makeSnapshot (3000.f), left, right));
+
+    CHECK (cache.getTotalSize() <= 2 * fileSize);
+    CHECK (cache.getFile (IR_Key::from (makeSnapshot (1000.f))).existsAsFile());
+    CHECK_FALSE (cache.getFile (IR_Key::from (makeSnapshot (2000.f))).existsAsFile());
+    CHECK (cache.getFile (IR_Key::from (makeSnapshot (3000.f))).existsAsFile());
+
+    cache.getDirectory().deleteRecursively();
+}
@@ -0,0 +1,145 @@
+#include <catch2/catch_test_macros.hpp>
+#include <cmath>
+#include "waveguide_reverb/waveguide_reverb.h"
+
+using Colin::Cpu_Level;
+using Colin::Kernel_Dispatch;
+
+namespace
+{
+    constexpr int N = 16;
+
+    bool close (float a, float b, float tolerance = 1.0e-5f)
+    {
+        return std::abs (a - b) <= tolerance * (1.f + std::abs (b));
+    }
+
+    void referenceHadamard (float* data, int size)
+    {
+        if (size <= 1)
+            return;
+        const int h = size / 2;
+        referenceHadamard (data, h);
+        referenceHadamard (data + h, h);
+        for (int i = 0; i < h; i++)
+        {
+            const float a = data[i];
+            const float b = data[i + h];
+            data[i] = a + b;
+            data[i + h] = a - b;
+        }
+    }
+
+    float referenceSoftClip (float x)
+    {
+        return (2.f / juce::MathConstants<float>::pi) * std::atan (x);
+    }
+}
+
+TEST_CASE ("Every kernel level matches the scalar reference", "[kernels]")
+{
+    juce::Random random (1234);
+    float in[N];
+    for (int i = 0; i < N; i++)
+        in[i] = random.nextFloat() * 2.f - 1.f;
+
+    float hadamard[N];
+    std::copy (in, in + N, hadamard);
+    referenceHadamard (hadamard, N);
+    for (int i = 0; i < N; i++)
+        hadamard[i] *= 0.25f;
+
+    const auto levels = Kernel_Dispatch::getAvailable();
+    CHECK (levels.front() == Cpu_Level::Baseline);
+    for (const auto level : levels)
+    {
+        REQUIRE (Kernel_Dispatch::force (level));
+        const auto& kernels = Kernel_Dispatch::get();
+        INFO (kernels.name);
+        CHECK (kernels.level == level);
+
+        float out[N];
+        kernels.hadamard (in, out);
+        for (int i = 0; i < N; i++)
+            CHECK (close (out[i], hadamard[i]));
+
+        // the feedback write against the reflection written out
+        Colin::data input, output, write;
+        float lfo[N];
+        for (int i = 0; i < N; i++)
+        {
+            input.channels[i] = random.nextFloat() * 2.f - 1.f;
+            output.channels[i] = random.nextFloat() * 2.f - 1.f;
+            lfo[i] = 1.f + (random.nextFloat() * 2.f - 1.f) * 0.01f;
+        }
+        float sum = 0.f;
+        for (int i = 0; i < N; i++)
+            sum += output.channels[i];
+        kernels.feedback (input, output, 0.85f, lfo, write);
+        for (int i = 0; i < N; i++)
+            CHECK (close (write.channels[i], input.channels[i] + (output.channels[i] - sum * 2.f / N) * 0.85f * lfo[i]));
+
+        // body modes against the biquads they replaced
+        Colin::Modal_Bank bank;
+        std::vector<Colin::Biquad_Filter> filters (Colin::Modal_Bank::NUM_MODES);
+        for (int mode = 0; mode < Colin::Modal_Bank::NUM_MODES; mode++)
+        {
+            const double w = 0.01 + 0.02 * mode;
+            const double r = 0.99;
+            const double b[3] = {0.05, 0.0, -0.05};
+            const double a[3] = {1.0, -2.0 * r * std::cos (w), r * r};
+            bank.setCoefficients (mode, b[0], b[1], b[2], a[1], a[2]);
+            filters[(size_t) mode].setCoefficients (b[0], b[1], b[2], a[1], a[2]);
+        }
+        bool modesMatch = true;
+        for (int i = 0; i < 1000; i++)
+        {
+            const float x = i == 0 ? 1.f : random.nextFloat() * 0.1f;
+            float expected = 0.f;
+            for (auto& filter : filters)
+                expected += filter.processAudioSample (x);
+            modesMatch = modesMatch && close (kernels.modalBank (bank, x), expected, 1.0e-4f);
+        }
+        CHECK (modesMatch);
+
+        float wet[37], dry[37], clipped[37];
+        for (int i = 0; i < 37; i++)
+        {
+            wet[i] = (random.nextFloat() * 2.f - 1.f) * 20.f;
+            dry[i] = random.nextFloat() * 2.f - 1.f;
+        }
+        kernels.outputStage (wet, dry, clipped, 37, 0.8f, 0.6f, 0.4f);
+        for (int i = 0; i < 37; i++)
+        {
+            CHECK (close (clipped[i], referenceSoftClip (wet[i] * 0.8f * 0.6f + dry[i] * 0.4f)));
+            CHECK (std::abs (clipped[i]) < 1.f);
+        }
+
+        // output decoding against the plain matrix product
+        alignas (64) float frames[5 * N];
+        alignas (64) float matrix[N * N];
+        for (auto& x : frames)
+            x = random.nextFloat() * 2.f - 1.f;
+        for (auto& x : matrix)
+            x = random.nextFloat() * 2.f - 1.f;
+        float decoded[12][5];
+        float* outputs[12];
+        for (int c = 0; c < 12; c++)
+            outputs[c] = decoded[c];
+        kernels.decode (frames, matrix, outputs, 12, 5);
+        bool decodeMatches = true;
+        for (int c = 0; c < 12; c++)
+        {
+            for (int i = 0; i < 5; i++)
+            {
+                float expected = 0.f;
+                for (int k = 0; k < N; k++)
+                    expected += matrix[k * N + c] * frames[i * N + k];
+                decodeMatches = decodeMatches && close (decoded[c][i], expected, 1.0e-4f);
+            }
+        }
+        CHECK (decodeMatches);
+    }
+    Kernel_Dispatch::reset();
+    CHECK (Kernel_Dispatch::get().level == levels.back());
+}
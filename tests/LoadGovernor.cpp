@@ -0,0 +1,85 @@
+#include "helpers/test_helpers.h"
+#include <catch2/catch_test_macros.hpp>
+
+using Colin::Load_Governor;
+using Colin::Quality_Tier;
+using Colin::WaveVerb;
+
+TEST_CASE ("The governor steps down quickly and back up slowly", "[governor]")
+{
+    Load_Governor governor;
+    governor.prepare (48000.0, 480);
+    governor.setThreshold (0.7f);
+
+    // 100 ms over the threshold per step
+    for (int block = 0; block < 9; block++)
+        governor.update (0.9, 480);
+    CHECK (governor.getTier() == Quality_Tier::Full);
+    governor.update (0.9, 480);
+    CHECK (governor.getTier() == Quality_Tier::Short_Diffusion);
+    for (int block = 0; block < 100; block++)
+        governor.update (0.9, 480);
+    CHECK (governor.getTier() == Load_Governor::LOWEST_TIER);
+
+    // between the recovery load and the threshold nothing moves
+    for (int block = 0; block < 1000; block++)
+        governor.update (0.5, 480);
+    CHECK (governor.getTier() == Load_Governor::LOWEST_TIER);
+
+    // 3 s of headroom per step back up, a spike starts the wait again
+    for (int block = 0; block < 299; block++)
+        governor.update (0.2, 480);
+    governor.update (0.8, 480);
+    for (int block = 0; block < 299; block++)
+        governor.update (0.2, 480);
+    CHECK (governor.getTier() == Load_Governor::LOWEST_TIER);
+    governor.update (0.2, 480);
+    CHECK (governor.getTier() == Quality_Tier::Fewer_Strings);
+    CHECK (governor.getTierChanges() == 4);
+}
+
+TEST_CASE ("A voice limit releases the voices above it", "[governor]")
+{
+    Colin::Voice_Allocator voices;
+    const int chord[] = { 48, 52, 55, 60 };
+    voices.allocate (chord, 4);
+
+    voices.setVoiceLimit (8);
+    CHECK (voices.allocate (chord, 4) == 0xff00u);
+    for (int v = 0; v < 8; v++)
+        CHECK (voices.getNote (v) == chord[v % 4]);
+    for (int v = 8; v < Colin::Voice_Allocator::NUM_VOICES; v++)
+        CHECK (voices.getNote (v) == Colin::Voice_Allocator::NO_NOTE);
+
+    voices.setVoiceLimit (Colin::Voice_Allocator::NUM_VOICES);
+    CHECK (voices.allocate (chord, 4) == 0xff00u);
+}
+
+TEST_CASE ("Every tier renders and the engine comes back to full quality", "[governor]")
+{
+    WaveVerb verb;
+    verb.setModel (Colin::String);
+    verb.prepareToPlay (48000.0, 480);
+    verb.setDryWet (100.f);
+    verb.setBlend (50.f);
+    // any load at all is too much, so every block counts towards the next step down
+    verb.setLoadGovernor (true, 0.f);
+
+    juce::Random random (7);
+    const auto out = renderBlocks (verb, 2, 480, 100, [&] (juce::AudioBuffer<float>& buffer, int)
+    {
+        for (int i = 0; i < 480; i++)
+        {
+            const float noise = random.nextFloat() * 0.2f - 0.1f;
+            buffer.setSample (0, i, noise);
+            buffer.setSample (1, i, noise);
+        }
+    });
+    CHECK (allFinite (out[0]));
+    CHECK (energy (out[0]) > 0.0);
+    CHECK (verb.getQualityTier() == Load_Governor::LOWEST_TIER);
+
+    verb.setLoadGovernor (false);
+    renderBlocks (verb, 2, 480, 1);
+    CHECK (verb.getQualityTier() == Quality_Tier::Full);
+}
@@ -0,0 +1,135 @@
+#include <catch2/catch_test_macros.hpp>
+#include <cmath>
+#include "waveguide_reverb/waveguide_reverb.h"
+
+using Colin::WaveVerb;
+
+namespace
+{
+    /// a click on the input while one midi note is held, let go at the end
+    std::vector<float> playNote (WaveVerb& verb, int note, int blocks = 80)
+    {
+        juce::AudioBuffer<float> buffer (2, 256);
+        std::vector<float> out;
+        for (int block = 0; block < blocks; block++)
+        {
+            buffer.clear();
+            juce::MidiBuffer midi;
+            if (block == 0)
+            {
+                buffer.setSample (0, 0, 1.f);
+                buffer.setSample (1, 0, 1.f);
+                midi.addEvent (juce::MidiMessage::noteOn (1, note, 1.f), 0);
+            }
+            if (block == blocks - 1)
+                midi.addEvent (juce::MidiMessage::noteOff (1, note), 255);
+            verb.processBuffer (buffer, midi);
+            for (int i = 0; i < 256; i++)
+                out.push_back (buffer.getSample (0, i));
+        }
+        return out;
+    }
+}
+
+TEST_CASE ("Memory usage is reported by component and stays put across prepares", "[memory]")
+{
+    WaveVerb verb;
+    verb.prepareToPlay (48000.0);
+    const auto first = verb.getMemoryUsage();
+    CHECK (first.strings > 0);
+    CHECK (first.diffusion > 0);
+    CHECK (first.feedback > 0);
+    CHECK (first.engine > 0);
+
+    // preparing again must not pile up delay lines
+    for (int i = 0; i < 5; i++)
+        verb.prepareToPlay (48000.0);
+    CHECK (verb.getMemoryUsage().total() == first.total());
+}
+
+TEST_CASE ("Compact mode shrinks the strings", "[memory]")
+{
+    WaveVerb full, compact;
+    compact.setCompact (true);
+    full.prepareToPlay (96000.0);
+    compact.prepareToPlay (96000.0);
+    CHECK_FALSE (full.isCompact());
+    CHECK (compact.isCompact());
+    CHECK (compact.getMemoryUsage().strings * 3 < full.getMemoryUsage().strings);
+    CHECK (compact.getMemoryUsage().feedback == full.getMemoryUsage().feedback);
+}
+
+TEST_CASE ("The process total follows every instance and its limit forces compact", "[memory]")
+{
+    WaveVerb first;
+    first.setProcessMemoryLimit (0);
+    const auto before = first.getProcessMemoryUsage();
+    first.prepareToPlay (48000.0);
+    const auto one = first.getMemoryUsage().total();
+    CHECK (first.getProcessMemoryUsage() == before + one);
+
+    {
+        WaveVerb second;
+        first.setProcessMemoryLimit (before + one + one / 2);
+        second.prepareToPlay (48000.0);
+        CHECK (second.isCompact());
+        CHECK (second.isOverMemoryLimit());
+        CHECK_FALSE (first.isOverMemoryLimit());
+        CHECK (first.getProcessMemoryUsage() == before + one + second.getMemoryUsage().total());
+        first.setProcessMemoryLimit (0);
+    }
+    CHECK (first.getProcessMemoryUsage() == before + one);
+}
+
+TEST_CASE ("Prefaulted engines are mapped in and sized for the largest room", "[memory]")
+{
+    WaveVerb verb;
+    verb.setPrefault (true);
+    verb.prepareToPlay (48000.0);
+    const auto report = verb.getResidencyReport();
+    CHECK (report.bytes.touched > verb.getMemoryUsage().total() / 2);
+    CHECK (report.bytes.locked == 0);
+
+    // a bigger room fits in what prepare reserved
+    const auto before = verb.getMemoryUsage().total();
+    verb.setSize (300.f, 2.f);
+    CHECK (verb.getMemoryUsage().total() == before);
+}
+
+TEST_CASE ("Compact strings refuse a note they have no room for rather than moving it", "[memory]")
+{
+    WaveVerb full, compact;
+    compact.setCompact (true);
+    for (auto* verb : { &full, &compact })
+    {
+        verb->setModel (Colin::String);
+        verb->prepareToPlay (48000.0, 256);
+        verb->setDryWet (100.f);
+        verb->setBlend (50.f);
+    }
+    // every chord fits without a midi note played
+    CHECK (compact.getLowestPlayableNote() == Colin::Tuning_Bank::LOWEST_ROOT);
+
+    // lower than any chord, counted and left silent instead of played an octave up
+    const auto reference = playNote (full, 30);
+    const auto refused = playNote (compact, 30);
+    CHECK (compact.getRefusedNotes() == 1);
+    CHECK (full.getRefusedNotes() == 0);
+    CHECK (refused != reference);
+
+    // the next prepare makes room for it, and it plays at its own pitch, a new rate rebuilds both the same way
+    const auto before = compact.getMemoryUsage().strings;
+    compact.prepareToPlay (44100.0, 256);
+    full.prepareToPlay (44100.0, 256);
+    CHECK (compact.getLowestPlayableNote() == 30);
+    CHECK (compact.isCompact());
+    CHECK (compact.getMemoryUsage().strings > before);
+    CHECK (compact.getMemoryUsage().strings < full.getMemoryUsage().strings);
+    const auto played = playNote (compact, 30);
+    const auto again = playNote (full, 30);
+    CHECK (compact.getRefusedNotes() == 1);
+    float difference = 0.f;
+    for (size_t i = 0; i < played.size(); i++)
+        difference = std::max (difference, std::abs (played[i] - again[i]));
+    CHECK (difference < 1.0e-5f);
+}
@@ -0,0 +1,57 @@
+#include <catch2/catch_test_macros.hpp>
+#include <cmath>
+#include "waveguide_reverb/waveguide_reverb.h"
+
+using Colin::data;
+using Colin::NUM_CHANNELS;
+
+namespace
+{
+    /// the sylvester construction, entry (row, column) is -1 where the two share an odd number of bits
+    float hadamardEntry (int row, int column)
+    {
+        int bits = row & column;
+        int parity = 0;
+        while (bits != 0)
+        {
+            parity ^= bits & 1;
+            bits >>= 1;
+        }
+        return parity == 0 ? 1.f : -1.f;
+    }
+}
+
+TEST_CASE ("The Hadamard mix stays within its own frame", "[matrix]")
+{
+    Colin::Mix_Matrix matrix;
+    // the recursion once stepped over whole frames instead of channels, so the
+    // result depended on whatever sat next to the frame, fill the neighbours with noise
+    data frames[3];
+    juce::Random random (7);
+    for (auto& frame : frames)
+        for (auto& x : frame.channels)
+            x = random.nextFloat() * 2.f - 1.f;
+    const data before = frames[2];
+
+    const data mixed = matrix.Hadamard (frames[1]);
+    const float scale = 1.f / std::sqrt (static_cast<float> (NUM_CHANNELS));
+    float inEnergy = 0.f, outEnergy = 0.f;
+    for (int row = 0; row < NUM_CHANNELS; row++)
+    {
+        float expected = 0.f;
+        for (int column = 0; column < NUM_CHANNELS; column++)
+            expected += hadamardEntry (row, column) * frames[1].channels[column];
+        CHECK (std::abs (mixed.channels[row] - expected * scale) < 1.0e-5f);
+        inEnergy += frames[1].channels[row] * frames[1].channels[row];
+        outEnergy += mixed.channels[row] * mixed.channels[row];
+    }
+    CHECK (std::abs (inEnergy - outEnergy) < 1.0e-4f);
+
+    // its own inverse, and the neighbours are left alone
+    const data back = matrix.Hadamard (mixed);
+    for (int i = 0; i < NUM_CHANNELS; i++)
+    {
+        CHECK (std::abs (back.channels[i] - frames[1].channels[i]) < 1.0e-5f);
+        CHECK (frames[2].channels[i] == before.channels[i]);
+    }
+}
@@ -0,0 +1,60 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/matchers/catch_matchers_floating_point.hpp>
+#include "waveguide_reverb/waveguide_reverb.h"
+
+using Catch::Matchers::WithinAbs;
+using Colin::Rate_Converter;
+
+// runs a sine through down() and up() and returns the rms of the settled output
+static float roundTripRms (int factor, float cyclesPerSample)
+{
+    Rate_Converter<1> converter;
+    converter.prepare (factor);
+    double sum = 0.0;
+    const int settle = 256;
+    const int length = 4096;
+    for (int i = 0; i < settle + length; i++)
+    {
+        const float in = std::sin (2.f * 3.14159265f * cyclesPerSample * static_cast<float> (i));
+        float low = 0.f;
+        if (converter.down (&in, &low))
+            converter.up (&low);
+        const float out = *converter.next();
+        if (i >= settle)
+            sum += out * out;
+    }
+    return static_cast<float> (std::sqrt (sum / length));
+}
+
+TEST_CASE ("Rate converter passes dc at unity gain", "[multirate]")
+{
+    for (int factor : { 1, 2, 4 })
+    {
+        Rate_Converter<2> converter;
+        converter.prepare (factor);
+        const float in[2] = { 0.5f, -0.25f };
+        float low[2] = { 0.f, 0.f };
+        const float* out = nullptr;
+        for (int i = 0; i < 512; i++)
+        {
+            if (converter.down (in, low))
+                converter.up (low);
+            out = converter.next();
+        }
+        CHECK_THAT (out[0], WithinAbs (0.5f, 0.001f));
+        CHECK_THAT (out[1], WithinAbs (-0.25f, 0.001f));
+    }
+}
+
+TEST_CASE ("Rate converter keeps the passband and rejects the band it cannot hold", "[multirate]")
+{
+    const float sineRms = std::sqrt (0.5f);
+
+    // well inside the crossover band
+    CHECK_THAT (roundTripRms (2, 0.05f), WithinAbs (sineRms, 0.02f));
+    CHECK_THAT (roundTripRms (4, 0.025f), WithinAbs (sineRms, 0.02f));
+
+    // above the reduced nyquist, nothing should come back
+    CHECK (roundTripRms (2, 0.4f) < 0.01f);
+    CHECK (roundTripRms (4, 0.2f) < 0.01f);
+}
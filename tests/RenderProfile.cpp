@@ -0,0 +1,69 @@
+#include "helpers/test_helpers.h"
+#include <catch2/catch_test_macros.hpp>
+
+using Colin::Render_Profile;
+using Colin::WaveVerb;
+
+// a second of noise through the engine, then the tail
+static std::vector<float> render (WaveVerb& verb, double fs)
+{
+    verb.prepareToPlay (fs, 512);
+    verb.setDryWet (100.f);
+    verb.setBlend (50.f);
+    juce::Random random (3);
+    return renderBlocks (verb, 2, 512, 150, [&] (juce::AudioBuffer<float>& buffer, int block)
+    {
+        if (block >= 90)
+            return;
+        for (int i = 0; i < 512; i++)
+        {
+            const float noise = random.nextFloat() * 0.2f - 0.1f;
+            buffer.setSample (0, i, noise);
+            buffer.setSample (1, i, noise);
+        }
+    })[0];
+}
+
+TEST_CASE ("Bounces are identical however the engine was used before", "[profile]")
+{
+    WaveVerb verb;
+    verb.setModel (Colin::String);
+    verb.setRenderProfile (Render_Profile::bounce());
+    const auto first = render (verb, 96000.0);
+    CHECK (verb.getRateFactor() == 1);
+    CHECK (verb.isPipelining());
+
+    // back to live playback, then a second bounce
+    verb.setRenderProfile (Render_Profile::live());
+    render (verb, 96000.0);
+    CHECK (verb.getRateFactor() == 2);
+    CHECK (! verb.isPipelining());
+
+    verb.setRenderProfile (Render_Profile::bounce());
+    const auto second = render (verb, 96000.0);
+    CHECK (first == second);
+}
+
+TEST_CASE ("A profile switch takes effect without a prepare", "[profile]")
+{
+    // a budget this small leaves a room change spread over many blocks
+    auto slow = Render_Profile::live();
+    slow.updateBudgetUS = 0.001f;
+    WaveVerb verb;
+    verb.setRenderProfile (slow);
+    verb.prepareToPlay (48000.0, 512);
+    juce::AudioBuffer<float> buffer (2, 512);
+    buffer.clear();
+    verb.setSize (250.f, 3.f);
+    verb.processBuffer (buffer);
+    CHECK (verb.hasPendingUpdates());
+
+    // the host going offline, nothing prepares again
+    verb.switchRenderProfile (Render_Profile::bounce());
+    verb.processBuffer (buffer);
+    CHECK (! verb.hasPendingUpdates());
+    verb.setSize (100.f, 2.f);
+    CHECK (! verb.hasPendingUpdates());
+    verb.processBuffer (buffer);
+    CHECK (! verb.hasPendingUpdates());
+}
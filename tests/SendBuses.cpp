@@ -0,0 +1,206 @@
+#include "helpers/test_helpers.h"
+#include <catch2/catch_test_macros.hpp>
+#include <cmath>
+
+using Colin::Input_Matrix;
+using Colin::WaveVerb;
+
+namespace
+{
+    void prepare (WaveVerb& verb)
+    {
+        verb.prepareToPlay (48000.0, 256);
+        verb.setDryWet (100.f);
+    }
+
+    /// one burst of noise at the start of the given channels, the output's channel 0 over the blocks
+    std::vector<float> render (WaveVerb& verb, int numChannels, const std::initializer_list<int> excited, int blocks = 40)
+    {
+        const std::vector<int> channels (excited);
+        return renderBlocks (verb, numChannels, 256, blocks, [&] (juce::AudioBuffer<float>& buffer, int block)
+        {
+            if (block != 0)
+                return;
+            juce::Random random (5);
+            for (int i = 0; i < 64; i++)
+            {
+                const float noise = random.nextFloat() * 0.2f - 0.1f;
+                for (const int channel : channels)
+                    buffer.setSample (channel, i, noise);
+            }
+        })[0];
+    }
+
+    /// the first sample louder than the threshold
+    size_t onset (const std::vector<float>& out, float threshold = 1.0e-6f)
+    {
+        for (size_t i = 0; i < out.size(); i++)
+            if (std::abs (out[i]) > threshold)
+                return i;
+        return out.size();
+    }
+}
+
+TEST_CASE ("Every bus injects the same energy in its own pattern", "[sends]")
+{
+    Colin::Mix_Matrix matrix;
+    Colin::data main = matrix.stereoToMulti (0.3f, -0.7f);
+    Colin::data previous;
+    for (int bus = 0; bus < Input_Matrix::MAX_BUSES; bus++)
+    {
+        Colin::data left, right;
+        Input_Matrix::defaultInjection (bus, left, right);
+        float leftEnergy = 0.f, rightEnergy = 0.f, overlap = 0.f;
+        for (int i = 0; i < 16; i++)
+        {
+            leftEnergy += left.channels[i] * left.channels[i];
+            rightEnergy += right.channels[i] * right.channels[i];
+            overlap += left.channels[i] * right.channels[i];
+        }
+        CHECK (std::abs (leftEnergy - 8.f) < 1.0e-4f);
+        CHECK (std::abs (rightEnergy - 8.f) < 1.0e-4f);
+        CHECK (std::abs (overlap) < 1.0e-4f);
+
+        // the main input's own pattern is where the turns start
+        if (bus == 0)
+        {
+            for (int i = 0; i < 16; i++)
+                CHECK (std::abs (left.channels[i] * 0.3f - right.channels[i] * 0.7f - main.channels[i]) < 1.0e-6f);
+        }
+        else
+        {
+            float difference = 0.f;
+            for (int i = 0; i < 16; i++)
+                difference = std::max (difference, std::abs (left.channels[i] - previous.channels[i]));
+            CHECK (difference > 0.1f);
+        }
+        previous = left;
+    }
+}
+
+TEST_CASE ("Sends share the network with the main input", "[sends]")
+{
+    WaveVerb plain, routed;
+    prepare (plain);
+    routed.setSendBus (1, 2, 2);
+    routed.setSendBus (2, 4, 1);
+    prepare (routed);
+    CHECK (! plain.hasSends());
+    REQUIRE (routed.hasSends());
+
+    // silent sends leave the main input sounding as it did
+    const auto a = render (plain, 2, { 0, 1 });
+    const auto b = render (routed, 5, { 0, 1 });
+    float difference = 0.f;
+    for (size_t i = 0; i < a.size(); i++)
+        difference = std::max (difference, std::abs (a[i] - b[i]));
+    CHECK (difference < 1.0e-4f);
+
+    // each send on its own reaches the main output, a different way from the main input
+    prepare (routed);
+    const auto fromSend = render (routed, 5, { 2, 3 });
+    prepare (routed);
+    const auto fromMono = render (routed, 5, { 4 });
+    CHECK (energy (fromSend) > 0.0);
+    CHECK (energy (fromMono) > 0.0);
+    bool finite = true;
+    float sendDifference = 0.f;
+    for (size_t i = 0; i < a.size(); i++)
+    {
+        finite = finite && std::isfinite (fromSend[i]) && std::isfinite (fromMono[i]);
+        sendDifference = std::max (sendDifference, std::abs (fromSend[i] - a[i]));
+    }
+    CHECK (finite);
+    CHECK (sendDifference > 1.0e-3f);
+
+    // a buffer without the sends in it falls back to the main input alone
+    prepare (routed);
+    const auto narrow = render (routed, 2, { 0, 1 });
+    float narrowDifference = 0.f;
+    for (size_t i = 0; i < a.size(); i++)
+        narrowDifference = std::max (narrowDifference, std::abs (a[i] - narrow[i]));
+    CHECK (narrowDifference < 1.0e-4f);
+
+    // turned off again, nothing is left allocated for them
+    routed.setSendBus (1, 0, 0);
+    routed.setSendBus (2, 0, 0);
+    prepare (routed);
+    CHECK (! routed.hasSends());
+    CHECK (routed.getMemoryUsage().engine == plain.getMemoryUsage().engine);
+}
+
+TEST_CASE ("Each send has its own pre-delay", "[sends]")
+{
+    // the network itself takes about a room's length to answer
+    WaveVerb verb;
+    verb.setSendBus (1, 2, 2);
+    prepare (verb);
+    const size_t direct = onset (render (verb, 4, { 2, 3 }, 80));
+    REQUIRE (direct < 80 * 256);
+
+    verb.setSendPreDelay (1, 100.f);
+    prepare (verb);
+    const size_t delayed = onset (render (verb, 4, { 2, 3 }, 80));
+    CHECK (delayed == direct + 4800);
+
+    // the main input isn't held back by a send's pre-delay
+    prepare (verb);
+    CHECK (onset (render (verb, 4, { 0, 1 }, 80)) < delayed - 2400);
+
+    // clamped to the line's length
+    verb.setSendPreDelay (1, 2000.f);
+    prepare (verb);
+    CHECK (onset (render (verb, 4, { 2, 3 }, 160)) == direct + 24000);
+}
+
+TEST_CASE ("Sends pipeline to the same result", "[sends]")
+{
+    WaveVerb serial, pipelined;
+    pipelined.setPipelining (true);
+    for (auto* verb : { &serial, &pipelined })
+    {
+        verb->setSendBus (1, 2, 2);
+        verb->setSendPreDelay (1, 20.f);
+        prepare (*verb);
+    }
+    CHECK (render (serial, 4, { 1, 2 }) == render (pipelined, 4, { 1, 2 }));
+}
+
+TEST_CASE ("A pre-delay change crossfades instead of jumping", "[sends]")
+{
+    Input_Matrix sends;
+    sends.setRouting (1, 2, 1);
+    sends.prepare (48000.0);
+
+    // a slow sine on a mono send, watched on one of the lines
+    juce::AudioBuffer<float> buffer (3, 256);
+    buffer.clear();
+    std::vector<Colin::data> frames (256);
+    std::vector<float> line;
+    int phase = 0;
+    for (int block = 0; block < 40; block++)
+    {
+        for (int i = 0; i < 256; i++)
+            buffer.setSample (2, i, std::sin (2.f * juce::MathConstants<float>::pi * 100.f * static_cast<float> (phase++) / 48000.f));
+        if (block == 10)
+            sends.setPreDelay (1, 37.f);
+        sends.process (buffer, 0, 256, buffer.getReadPointer (0), buffer.getReadPointer (1), frames.data());
+        for (const auto& frame : frames)
+            line.push_back (frame.channels[2]);
+    }
+
+    // a jump would step by up to twice the amplitude, the sine itself moves about 0.02 per sample
+    float largestStep = 0.f;
+    for (size_t i = 1; i < line.size(); i++)
+        largestStep = std::max (largestStep, std::abs (line[i] - line[i - 1]));
+    CHECK (largestStep < 0.05f);
+
+    // settled on the new time, a 37 ms later copy of the same sine
+    Colin::data left, right;
+    Input_Matrix::defaultInjection (1, left, right);
+    const int delay = juce::roundToInt (48000.0 * 0.037);
+    const size_t last = line.size() - 1;
+    const float expected = left.channels[2] * std::sin (2.f * juce::MathConstants<float>::pi * 100.f * static_cast<float> (static_cast<int> (last) - delay) / 48000.f)
+                         - right.channels[2] * std::sin (2.f * juce::MathConstants<float>::pi * 100.f * static_cast<float> (static_cast<int> (last) - delay) / 48000.f);
+    CHECK (std::abs (line[last] - expected) < 1.0e-3f);
+}
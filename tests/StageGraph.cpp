@@ -0,0 +1,59 @@
+#include "helpers/test_helpers.h"
+#include <catch2/catch_test_macros.hpp>
+
+using Colin::Graph_Layout;
+using Colin::WaveVerb;
+
+static_assert (Colin::Graph_Split<Colin::Serial_Graph>::HOST_RATE_STRINGS);
+static_assert (Colin::Graph_Split<Colin::Parallel_Graph>::HOST_RATE_STRINGS);
+static_assert (! Colin::Graph_Split<Colin::Strings_After_Late_Graph>::HOST_RATE_STRINGS);
+
+// energy of the wet response to an impulse, zero if anything went non finite
+static double renderTail (Graph_Layout layout)
+{
+    WaveVerb verb;
+    verb.setGraphLayout (layout);
+    verb.setModel (Colin::String);
+    verb.prepareToPlay (48000.0);
+    verb.setDryWet (100.f);
+    verb.setBlend (50.f);
+    CHECK (verb.getGraphLayout() == layout);
+
+    const auto out = renderBlocks (verb, 2, 512, 60, [] (juce::AudioBuffer<float>& buffer, int block)
+    {
+        if (block != 0)
+            return;
+        buffer.setSample (0, 0, 1.f);
+        buffer.setSample (1, 0, 1.f);
+    });
+    if (! allFinite (out[0]) || ! allFinite (out[1]))
+        return 0.0;
+    return energy (out[0]) + energy (out[1]);
+}
+
+TEST_CASE ("Every graph layout renders its own tail", "[graph]")
+{
+    const double serial = renderTail (Graph_Layout::Serial);
+    const double stringsAfterLate = renderTail (Graph_Layout::Strings_After_Late);
+    const double parallel = renderTail (Graph_Layout::Parallel);
+    CHECK (serial > 0.0);
+    CHECK (stringsAfterLate > 0.0);
+    CHECK (parallel > 0.0);
+    CHECK (serial != stringsAfterLate);
+    CHECK (serial != parallel);
+}
+
+TEST_CASE ("Layouts that excite the strings from the late reverb stay at the host rate", "[graph]")
+{
+    WaveVerb verb;
+    verb.setMultirate (Colin::Multirate_Mode::Half);
+    verb.setGraphLayout (Graph_Layout::Strings_After_Late);
+    verb.prepareToPlay (96000.0);
+    CHECK (verb.getRateFactor() == 1);
+
+    // a layout change is structural, the next prepare rebuilds
+    verb.setGraphLayout (Graph_Layout::Parallel);
+    verb.prepareToPlay (96000.0);
+    CHECK (verb.getGraphLayout() == Graph_Layout::Parallel);
+    CHECK (verb.getRateFactor() == 2);
+}
@@ -0,0 +1,122 @@
+#include <catch2/catch_test_macros.hpp>
+#include <cmath>
+#include <thread>
+#include "waveguide_reverb/waveguide_reverb.h"
+
+using Colin::Graph_Layout;
+using Colin::WaveVerb;
+
+TEST_CASE ("Pipelined rendering matches serial rendering sample for sample", "[pipeline]")
+{
+    for (const auto layout : { Graph_Layout::Serial, Graph_Layout::Parallel })
+    {
+        WaveVerb serial;
+        WaveVerb pipelined;
+        pipelined.setPipelining (true);
+        for (auto* verb : { &serial, &pipelined })
+        {
+            verb->setGraphLayout (layout);
+            verb->setModel (Colin::String);
+            verb->prepareToPlay (48000.0, 700);
+            verb->setDryWet (80.f);
+            verb->setBlend (40.f);
+        }
+        CHECK (pipelined.isPipelining());
+        CHECK (! serial.isPipelining());
+
+        juce::Random random (7);
+        juce::AudioBuffer<float> a (2, 700);
+        juce::AudioBuffer<float> b (2, 700);
+        bool identical = true;
+        for (int block = 0; block < 30; block++)
+        {
+            // uneven lengths so the last sub block is a partial one
+            const int length = 1 + (block * 97) % 700;
+            a.setSize (2, length, false, false, true);
+            b.setSize (2, length, false, false, true);
+            for (int i = 0; i < length; i++)
+            {
+                const float noise = block < 10 ? (random.nextFloat() * 2.f - 1.f) * 0.5f : 0.f;
+                a.setSample (0, i, noise);
+                a.setSample (1, i, -noise * 0.5f);
+            }
+            b.makeCopyOf (a);
+            serial.processBuffer (a);
+            pipelined.processBuffer (b);
+            for (int channel = 0; channel < 2; channel++)
+                for (int i = 0; i < length; i++)
+                    identical = identical && a.getSample (channel, i) == b.getSample (channel, i);
+        }
+        CHECK (identical);
+
+        // released engines stop their workers, prepare starts them again
+        pipelined.releaseResources();
+        CHECK (! pipelined.isPipelining());
+        pipelined.prepareToPlay (48000.0, 700);
+        CHECK (pipelined.isPipelining());
+    }
+}
+
+namespace
+{
+    /// two stages that only read their own input and one that needs both
+    struct Stages
+    {
+        std::vector<float> first, second, last;
+
+        explicit Stages (int length) : first ((size_t) length), second ((size_t) length), last ((size_t) length) {}
+
+        static void runFirst (void* context, int start, int end)
+        {
+            auto& stages = *static_cast<Stages*> (context);
+            for (int i = start; i < end; i++)
+                stages.first[(size_t) i] = std::sin (0.01f * (float) i);
+        }
+
+        static void runSecond (void* context, int start, int end)
+        {
+            auto& stages = *static_cast<Stages*> (context);
+            for (int i = start; i < end; i++)
+                stages.second[(size_t) i] = std::cos (0.02f * (float) i);
+        }
+
+        static void runLast (void* context, int start, int end)
+        {
+            auto& stages = *static_cast<Stages*> (context);
+            for (int i = start; i < end; i++)
+                stages.last[(size_t) i] = stages.first[(size_t) i] * stages.second[(size_t) i];
+        }
+    };
+}
+
+TEST_CASE ("Every pipeline shares one pool, more of them than workers still finish", "[pipeline]")
+{
+    const int numPipelines = juce::SharedResourcePointer<Colin::Worker_Pool>()->getNumWorkers() * 2 + 1;
+    const int length = 1000;
+
+    Stages reference (length);
+    Colin::Stage_Pipeline serial;
+    serial.run (length, &Stages::runFirst, &Stages::runSecond, &Stages::runLast, &reference);
+
+    std::vector<char> identical ((size_t) numPipelines, 1); // not vector<bool>, each thread writes its own element
+    std::vector<std::thread> renders;
+    for (int p = 0; p < numPipelines; p++)
+    {
+        renders.emplace_back ([&, p]
+        {
+            Colin::Stage_Pipeline pipeline;
+            pipeline.start();
+            for (int block = 0; block < 50; block++)
+            {
+                Stages stages (length);
+                pipeline.run (length, &Stages::runFirst, &Stages::runSecond, &Stages::runLast, &stages);
+                if (stages.last != reference.last)
+                    identical[(size_t) p] = 0;
+            }
+        });
+    }
+    for (auto& render : renders)
+        render.join();
+    for (const char same : identical)
+        CHECK (same == 1);
+}
@@ -0,0 +1,134 @@
+#include "helpers/test_helpers.h"
+#include <catch2/catch_test_macros.hpp>
+#include <cmath>
+
+using Colin::IO_Layout;
+using Colin::Output_Decoder;
+using Colin::WaveVerb;
+
+namespace
+{
+    constexpr int N = 16;
+
+    float columnEnergy (const Output_Decoder& decoder, int output)
+    {
+        float energy = 0.f;
+        for (int line = 0; line < N; line++)
+        {
+            const float gain = decoder.getMatrix()[line * Output_Decoder::MAX_OUTPUTS + output];
+            energy += gain * gain;
+        }
+        return energy;
+    }
+
+    void prepare (WaveVerb& verb, const juce::AudioChannelSet& output, int inputs = 2)
+    {
+        verb.setChannelLayout (inputs, output.size());
+        verb.setOutputLayout (output);
+        verb.prepareToPlay (48000.0, 256);
+        verb.setDryWet (100.f);
+    }
+
+    /// noise on the first two channels of every block
+    BlockFill stereoNoise()
+    {
+        return [random = juce::Random (3)] (juce::AudioBuffer<float>& buffer, int) mutable
+        {
+            for (int i = 0; i < buffer.getNumSamples(); i++)
+            {
+                buffer.setSample (0, i, random.nextFloat() * 0.1f - 0.05f);
+                buffer.setSample (1, i, random.nextFloat() * 0.1f - 0.05f);
+            }
+        };
+    }
+}
+
+TEST_CASE ("The decoder knows the surround and ambisonic layouts", "[surround]")
+{
+    CHECK (Output_Decoder::supports (juce::AudioChannelSet::create5point1()));
+    CHECK (Output_Decoder::supports (juce::AudioChannelSet::create7point1()));
+    CHECK (Output_Decoder::supports (juce::AudioChannelSet::create7point1point4()));
+    CHECK (Output_Decoder::supports (juce::AudioChannelSet::ambisonic (1)));
+    CHECK (Output_Decoder::supports (juce::AudioChannelSet::ambisonic (3)));
+    CHECK (! Output_Decoder::supports (juce::AudioChannelSet::stereo()));
+    CHECK (! Output_Decoder::supports (juce::AudioChannelSet::discreteChannels (12)));
+
+    // every speaker gets the same share, the lfe none
+    const auto layout = juce::AudioChannelSet::create7point1point4();
+    Output_Decoder decoder;
+    decoder.build (layout);
+    REQUIRE (decoder.getNumOutputs() == 12);
+    float total = 0.f;
+    for (int channel = 0; channel < 12; channel++)
+    {
+        const float energy = columnEnergy (decoder, channel);
+        if (layout.getTypeOfChannel (channel) == juce::AudioChannelSet::LFE)
+            CHECK (energy == 0.f);
+        else
+            CHECK (std::abs (energy - Output_Decoder::TOTAL_ENERGY / 11.f) < 1.0e-4f);
+        total += energy;
+    }
+    CHECK (std::abs (total - Output_Decoder::TOTAL_ENERGY) < 1.0e-3f);
+
+    // the omni channel takes every line equally
+    decoder.build (juce::AudioChannelSet::ambisonic (3));
+    REQUIRE (decoder.getNumOutputs() == 16);
+    for (int line = 0; line < N; line++)
+        CHECK (std::abs (decoder.getMatrix()[line * Output_Decoder::MAX_OUTPUTS] - std::sqrt (0.5f)) < 1.0e-6f);
+
+    decoder.build (juce::AudioChannelSet::stereo());
+    CHECK (! decoder.isActive());
+}
+
+TEST_CASE ("One engine fills every speaker with its own tail", "[surround]")
+{
+    const auto layout = juce::AudioChannelSet::create7point1point4();
+    WaveVerb verb;
+    prepare (verb, layout);
+    REQUIRE (verb.getIOLayout() == IO_Layout::Decoded);
+
+    const auto outputs = renderBlocks (verb, 12, 256, 60, stereoNoise());
+    std::vector<double> energies;
+    for (int channel = 0; channel < 12; channel++)
+    {
+        INFO (channel);
+        energies.push_back (energy (outputs[(size_t) channel]));
+        if (layout.getTypeOfChannel (channel) == juce::AudioChannelSet::LFE)
+            CHECK (energies.back() == 0.0);
+        else
+            CHECK (energies.back() > 0.0);
+        CHECK (energies.back() < 1.0e6);
+    }
+
+    // the speakers furthest apart share little of the tail
+    const auto& front = outputs[0];
+    const auto& rear = outputs.back();
+    double cross = 0.0;
+    for (size_t i = 0; i < front.size(); i++)
+        cross += front[i] * rear[i];
+    CHECK (std::abs (cross) / std::sqrt (energies[0] * energies.back()) < 0.5);
+
+    // about as loud overall as the stereo fold down
+    WaveVerb stereo;
+    prepare (stereo, juce::AudioChannelSet::stereo());
+    REQUIRE (stereo.getIOLayout() == IO_Layout::Stereo);
+    const auto pair = renderBlocks (stereo, 2, 256, 60, stereoNoise());
+    double surroundTotal = 0.0;
+    for (const double e : energies)
+        surroundTotal += e;
+    const double ratio = surroundTotal / (energy (pair[0]) + energy (pair[1]));
+    CHECK (ratio > 0.5);
+    CHECK (ratio < 2.0);
+}
+
+TEST_CASE ("Decoded outputs pipeline to the same result", "[surround]")
+{
+    const auto layout = juce::AudioChannelSet::ambisonic (3);
+    WaveVerb serial, pipelined;
+    pipelined.setPipelining (true);
+    prepare (serial, layout, 1);
+    prepare (pipelined, layout, 1);
+    REQUIRE (pipelined.getIOLayout() == IO_Layout::Decoded);
+
+    CHECK (renderBlocks (serial, 16, 256, 20, stereoNoise()) == renderBlocks (pipelined, 16, 256, 20, stereoNoise()));
+}
@@ -0,0 +1,66 @@
+#include <catch2/catch_test_macros.hpp>
+#include "waveguide_reverb/waveguide_reverb.h"
+
+using Colin::Table_Registry;
+using Colin::Tuning_Bank;
+using Colin::Tuning_Table;
+
+TEST_CASE ("Instances at the same rate share one tuning table", "[tables]")
+{
+    juce::SharedResourcePointer<Table_Registry<Tuning_Table>> registry;
+    const int before = registry->getNumTables();
+
+    auto first = registry->get (48000.0);
+    auto second = registry->get (48000.0);
+    auto other = registry->get (96000.0);
+    CHECK (first.get() == second.get());
+    CHECK (first.get() != other.get());
+    CHECK (first->sampleRate == 48000.0);
+    CHECK (other->sampleRate == 96000.0);
+    CHECK (registry->getNumTables() == before + 2);
+
+    // the last holder frees it
+    other.reset();
+    CHECK (registry->getNumTables() == before + 1);
+    first.reset();
+    second.reset();
+    CHECK (registry->getNumTables() == before);
+}
+
+TEST_CASE ("Shared tables match the ones built per instance", "[tables]")
+{
+    juce::SharedResourcePointer<Table_Registry<Tuning_Table>> registry;
+    const auto shared = registry->get (44100.0);
+    Tuning_Table local;
+    local.build (44100.0);
+    for (int note = 0; note < Tuning_Table::NUM_NOTES; note++)
+    {
+        CHECK ((*shared)[note].frequency == local[note].frequency);
+        CHECK ((*shared)[note].lpf[0] == local[note].lpf[0]);
+        CHECK ((*shared)[note].apf[2] == local[note].apf[2]);
+    }
+}
+
+TEST_CASE ("Every root and chord is built ahead for the rate", "[tables]")
+{
+    juce::SharedResourcePointer<Table_Registry<Tuning_Bank>> registry;
+    const auto bank = registry->get (48000.0);
+    CHECK (bank.get() == registry->get (48000.0).get());
+    const auto table = Table_Registry<Tuning_Table>().get (48000.0);
+
+    // D minor, from the root parameter's C
+    const auto& minor = bank->get (Colin::D, Colin::Minor);
+    REQUIRE (minor.numNotes == Tuning_Bank::CHORD_SIZE);
+    const int expected[] = { 50, 53, 57, 62 };
+    for (int i = 0; i < Tuning_Bank::CHORD_SIZE; i++)
+    {
+        CHECK (minor.notes[(size_t) i] == expected[i]);
+        CHECK (minor.rows[(size_t) i].frequency == (*table)[expected[i]].frequency);
+        CHECK (minor.rows[(size_t) i].lpf[0] == (*table)[expected[i]].lpf[0]);
+    }
+
+    // no chord leaves the strings to the held notes, out of range values don't read past the bank
+    CHECK (bank->get (Colin::A, Colin::Midi_Input).numNotes == 0);
+    CHECK (bank->get (40, 3).notes[0] == bank->get (Colin::B, 3).notes[0]);
+    CHECK (bank->get (0, 99).numNotes == 0);
+}
@@ -0,0 +1,186 @@
+#include "helpers/test_helpers.h"
+#include <catch2/catch_test_macros.hpp>
+#include <cmath>
+
+using Colin::Update_Scheduler;
+using Colin::WaveVerb;
+
+namespace
+{
+    struct Counting_Job
+    {
+        int units = 0;
+        int commits = 0;
+        int unitsAtCommit = 0;
+
+        // every odd unit has nothing to do, the rest take longer than the budget
+        static bool step (void* context, int unit)
+        {
+            auto& job = *static_cast<Counting_Job*> (context);
+            if (unit % 2 == 1)
+                return false;
+            const auto until = juce::Time::getHighResolutionTicks() + juce::Time::getHighResolutionTicksPerSecond() / 20000;
+            while (juce::Time::getHighResolutionTicks() < until) {}
+            job.units++;
+            return true;
+        }
+
+        static void commit (void* context)
+        {
+            auto& job = *static_cast<Counting_Job*> (context);
+            job.commits++;
+            job.unitsAtCommit = job.units;
+        }
+    };
+}
+
+TEST_CASE ("Scheduled jobs spread their units and commit once", "[updates]")
+{
+    Update_Scheduler updates;
+    Counting_Job counting;
+    const int id = updates.addJob (&Counting_Job::step, &Counting_Job::commit, &counting, 6);
+    updates.setBudget (10.0);
+
+    updates.schedule (id);
+    CHECK (updates.isPending (id));
+    updates.run();
+    CHECK (counting.units == 1);
+    updates.schedule (id); // while running, goes round again afterwards
+    updates.run();
+    updates.run();
+    CHECK (counting.units == 3);
+    CHECK (counting.commits == 0);
+    updates.run();
+    CHECK (counting.commits == 1);
+    CHECK (counting.unitsAtCommit == 3);
+    CHECK (updates.isPending (id));
+    updates.finishAll();
+    CHECK (counting.commits == 2);
+    CHECK (counting.units == 6);
+    CHECK (updates.isIdle());
+
+    // without a budget a job runs to the end when it is scheduled
+    updates.setBudget (0.0);
+    updates.schedule (id);
+    CHECK (counting.commits == 3);
+    CHECK (updates.isIdle());
+}
+
+TEST_CASE ("Shared line filter coefficients match the juce filter", "[updates]")
+{
+    juce::dsp::StateVariableTPTFilter<float> reference;
+    reference.prepare ({ 48000.0, 512, 1 });
+    reference.setType (juce::dsp::StateVariableTPTFilterType::lowpass);
+    reference.setResonance (0.707f);
+    reference.setCutoffFrequency (3000.f);
+
+    Colin::Line_Filter filter;
+    filter.setCoefficients (Colin::Line_Filter::Coefficients::lowpass (48000.0, 3000.f));
+    juce::Random random (5);
+    for (int i = 0; i < 1000; i++)
+    {
+        const float x = random.nextFloat() * 2.f - 1.f;
+        CHECK (std::abs (filter.processSample (x) - reference.processSample (0, x)) < 1.0e-6f);
+    }
+}
+
+TEST_CASE ("A spread out change ends up where an immediate one does", "[updates]")
+{
+    WaveVerb immediate;
+    WaveVerb spread;
+    spread.setUpdateBudget (1.f);
+    for (auto* verb : { &immediate, &spread })
+    {
+        verb->setModel (Colin::String);
+        verb->prepareToPlay (48000.0, 256);
+        verb->setDryWet (100.f);
+        verb->setBlend (50.f);
+    }
+
+    for (auto* verb : { &immediate, &spread })
+    {
+        verb->setSize (220.f, 3.f);
+        verb->setWaveguidePickup (0.6f);
+        verb->setChord (Colin::Major);
+    }
+
+    // both stay silent while the spread engine catches up
+    renderBlocks (spread, 2, 256, 1);
+    CHECK (spread.hasPendingUpdates());
+    int blocks = 1;
+    while (spread.hasPendingUpdates() && blocks < 100)
+    {
+        renderBlocks (immediate, 2, 256, 1);
+        renderBlocks (spread, 2, 256, 1);
+        blocks++;
+    }
+    renderBlocks (immediate, 2, 256, 1);
+    CHECK (! spread.hasPendingUpdates());
+    CHECK (blocks < 100);
+
+    const auto click = [] (juce::AudioBuffer<float>& buffer, int block)
+    {
+        if (block != 0)
+            return;
+        buffer.setSample (0, 0, 1.f);
+        buffer.setSample (1, 0, 1.f);
+    };
+    CHECK (renderBlocks (immediate, 2, 256, 40, click)[0] == renderBlocks (spread, 2, 256, 40, click)[0]);
+}
+
+TEST_CASE ("Nothing a spread change touches is heard before it commits", "[updates]")
+{
+    // a click every block keeps the strings ringing
+    const auto click = [] (juce::AudioBuffer<float>& buffer, int)
+    {
+        buffer.setSample (0, 0, 0.3f);
+        buffer.setSample (1, 0, 0.3f);
+    };
+
+    // the reference takes the change at once on the block the spread engine commits it, the
+    // network delays what the strings and the diffuser do by the room size, so the blocks after
+    // the commit are compared too
+    const auto holdsUntilCommit = [&] (const std::function<void (WaveVerb&)>& change)
+    {
+        WaveVerb unchanged;
+        WaveVerb reference;
+        WaveVerb spread;
+        spread.setUpdateBudget (1.f);
+        for (auto* verb : { &unchanged, &reference, &spread })
+        {
+            verb->setModel (Colin::String);
+            verb->setChord (Colin::Major);
+            verb->setWaveguideRate (1.f);
+            verb->prepareToPlay (48000.0, 256);
+            verb->setDryWet (100.f);
+            verb->setBlend (50.f);
+            renderBlocks (*verb, 2, 256, 80, click);
+        }
+
+        change (spread);
+        REQUIRE (spread.hasPendingUpdates());
+        int pending = 0;
+        while (spread.hasPendingUpdates() && pending < 100)
+        {
+            const auto after = renderBlocks (spread, 2, 256, 1, click);
+            if (! spread.hasPendingUpdates())
+                change (reference);
+            CHECK (renderBlocks (reference, 2, 256, 1, click) == after);
+            renderBlocks (unchanged, 2, 256, 1, click);
+            pending++;
+        }
+        CHECK (pending > 1);
+        CHECK (pending < 100);
+
+        const auto tail = renderBlocks (spread, 2, 256, 40, click);
+        CHECK (renderBlocks (reference, 2, 256, 40, click) == tail);
+        CHECK (renderBlocks (unchanged, 2, 256, 40, click) != tail);
+    };
+
+    holdsUntilCommit ([] (WaveVerb& verb)
+    {
+        verb.setWaveguidePickup (0.6f);
+        verb.setChord (Colin::Minor);
+    });
+    holdsUntilCommit ([] (WaveVerb& verb) { verb.setSize (220.f, 3.f); });
+}
@@ -0,0 +1,90 @@
+#include <catch2/catch_test_macros.hpp>
+#include "waveguide_reverb/waveguide_reverb.h"
+
+using Colin::Note_Stack;
+using Colin::Steal_Policy;
+using Colin::Voice_Allocator;
+
+static int countVoices (const Voice_Allocator& voices, int note)
+{
+    int n = 0;
+    for (int v = 0; v < Voice_Allocator::NUM_VOICES; v++)
+        n += voices.getNote (v) == note ? 1 : 0;
+    return n;
+}
+
+TEST_CASE ("Note stack keeps press order", "[voices]")
+{
+    Note_Stack stack;
+    stack.push (60);
+    stack.push (64);
+    stack.push (67);
+    stack.push (60); // pressed again, moves to the top
+
+    REQUIRE (stack.getSize() == 3);
+    CHECK (stack.begin()[0] == 64);
+    CHECK (stack.begin()[1] == 67);
+    CHECK (stack.begin()[2] == 60);
+
+    stack.remove (67);
+    stack.remove (99); // not held
+    REQUIRE (stack.getSize() == 2);
+    CHECK (stack.begin()[1] == 60);
+}
+
+TEST_CASE ("Voice allocator spreads notes over every voice", "[voices]")
+{
+    Voice_Allocator voices;
+    const int chord[] = { 48, 52, 55, 60 };
+
+    CHECK (voices.allocate (chord, 4) == 0xffffu);
+    for (int v = 0; v < Voice_Allocator::NUM_VOICES; v++)
+        CHECK (voices.getNote (v) == chord[v % 4]);
+
+    SECTION ("same notes again retune nothing")
+    {
+        CHECK (voices.allocate (chord, 4) == 0u);
+    }
+
+    SECTION ("releasing a note only moves its own voices")
+    {
+        const int remaining[] = { 48, 52, 60 };
+        const auto changed = voices.allocate (remaining, 3);
+        for (int v = 0; v < Voice_Allocator::NUM_VOICES; v++)
+            CHECK (((changed >> v) & 1u) == (chord[v % 4] == 55 ? 1u : 0u));
+        CHECK (countVoices (voices, 55) == 0);
+        CHECK (countVoices (voices, 48) + countVoices (voices, 52) + countVoices (voices, 60) == 16);
+    }
+
+    SECTION ("no notes frees every voice")
+    {
+        CHECK (voices.allocate (nullptr, 0) == 0xffffu);
+        CHECK (countVoices (voices, Voice_Allocator::NO_NOTE) == 16);
+    }
+}
+
+TEST_CASE ("Voice allocator steals by policy", "[voices]")
+{
+    int notes[20];
+    for (int i = 0; i < 20; i++)
+        notes[i] = 40 + i;
+
+    Voice_Allocator voices;
+
+    voices.setPolicy (Steal_Policy::Oldest);
+    voices.allocate (notes, 20);
+    CHECK (countVoices (voices, 40) == 0);
+    CHECK (countVoices (voices, 59) == 1);
+
+    voices.setPolicy (Steal_Policy::Lowest);
+    notes[19] = 10; // newest note is now the lowest
+    voices.allocate (notes, 20);
+    CHECK (countVoices (voices, 10) == 0);
+    CHECK (countVoices (voices, 40) == 0);
+    CHECK (countVoices (voices, 58) == 1);
+
+    voices.setPolicy (Steal_Policy::Highest);
+    voices.allocate (notes, 20);
+    CHECK (countVoices (voices, 10) == 1);
+    CHECK (countVoices (voices, 58) == 0);
+}
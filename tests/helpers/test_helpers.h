@@ -1,5 +1,6 @@
 #pragma once
 #include <PluginProcessor.h>
+#include <cmath>
 
 /* This is a helper function to run tests within the context of a plugin editor.
  *
@@ -29,3 +30,51 @@
     plugin.editorBeingDeleted (editor);
     delete editor;
 }
+
+/* Runs blocks through an engine and keeps what comes out.
+ *
+ * fill writes each block's input into the buffer, which is cleared first. Without a fill the
+ * engine hears silence. The result has one vector per channel with every block back to back.
+ *
+ * Example usage (a click, then the tail)
+ *
+  const auto out = renderBlocks (verb, 2, 512, 60, [] (juce::AudioBuffer<float>& buffer, int block) {
+    if (block == 0)
+        buffer.setSample (0, 0, 1.f);
+  });
+ */
+using BlockFill = std::function<void (juce::AudioBuffer<float>& buffer, int block)>;
+
+[[maybe_unused]] static std::vector<std::vector<float>> renderBlocks (Colin::WaveVerb& verb, int numChannels, int blockSize, int blocks, const BlockFill& fill = {})
+{
+    juce::AudioBuffer<float> buffer (numChannels, blockSize);
+    std::vector<std::vector<float>> out ((size_t) numChannels);
+    for (auto& channel : out)
+        channel.reserve ((size_t) (blockSize * blocks));
+    for (int block = 0; block < blocks; block++)
+    {
+        buffer.clear();
+        if (fill)
+            fill (buffer, block);
+        verb.processBuffer (buffer);
+        for (int channel = 0; channel < numChannels; channel++)
+            out[(size_t) channel].insert (out[(size_t) channel].end(), buffer.getReadPointer (channel), buffer.getReadPointer (channel) + blockSize);
+    }
+    return out;
+}
+
+[[maybe_unused]] static double energy (const std::vector<float>& samples)
+{
+    double sum = 0.0;
+    for (const float x : samples)
+        sum += x * x;
+    return sum;
+}
+
+[[maybe_unused]] static bool allFinite (const std::vector<float>& samples)
+{
+    for (const float x : samples)
+        if (! std::isfinite (x))
+            return false;
+    return true;
+}